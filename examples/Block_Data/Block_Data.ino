@@ -0,0 +1,82 @@
+/*
+Vrekrer_scpi_parser library.
+Arbitrary block parameters example.
+
+Demonstrates how to receive IEEE 488.2 arbitrary block parameters.
+A block starts with '#' followed by the number of length digits, the length
+and the raw data, e.g. "#15hello" or "#210hello world".
+The data may contain any char (including ';' and the termination chars) and
+can be larger than the message buffer, it is not copied to the buffer.
+The block must be the last parameter of the command.
+
+Commands:
+  *IDN?
+    Gets the instrument's identification string
+
+  DATA:UPLoad <block>
+    Receives a block of data, only the checksum and size are kept
+    e.g. DATA:UPLoad #211hello world
+
+  DATA:SUM?
+    Queries the size and checksum of the last received block
+*/
+
+//Enables the arbitrary block parameters
+//See the Configuration_Options example for further information.
+#define SCPI_BLOCK_DATA 1  //default 0
+
+#include "Arduino.h"
+#include "Vrekrer_scpi_parser.h"
+
+SCPI_Parser my_instrument;
+unsigned long block_size = 0;
+uint8_t block_checksum = 0;
+
+void setup()
+{
+  my_instrument.RegisterCommand(F("*IDN?"), &Identify);
+  my_instrument.SetCommandTreeBase(F("DATA"));
+    my_instrument.RegisterCommand(F(":UPLoad"), &Upload);
+    my_instrument.RegisterCommand(F(":SUM?"), &GetSum);
+
+  Serial.begin(9600);
+}
+
+void loop()
+{
+  my_instrument.ProcessInput(Serial, "\n");
+}
+
+void Identify(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  interface.println(F("Vrekrer,SCPI Block Data Example,#00,"
+                      VREKRER_SCPI_VERSION));
+}
+
+/*
+## Block handler definition. ##
+The last parameter is the block header (e.g. "#211"), the block data is read
+from the interface, which stops returning chars at the end of the block.
+The data not read here is discarded after this procedure returns.
+*/
+void Upload(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  char* header = parameters.Last();
+  if ((header == NULL) || (header[0] != '#')) return;
+  //Data length, from the header. "#0" blocks end with the termination chars.
+  unsigned long length = (header[1] == '0') ? 0 : strtoul(header + 2, NULL, 10);
+
+  block_size = 0;
+  block_checksum = 0;
+  char chunk[16];
+  while ((length == 0) || (block_size < length)) {
+    size_t chunk_size = interface.readBytes(chunk, sizeof(chunk));
+    if (chunk_size == 0) break; //End of the block (or timeout)
+    for (size_t i = 0; i < chunk_size; i++) block_checksum += chunk[i];
+    block_size += chunk_size;
+  }
+}
+
+void GetSum(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  interface.print(block_size);
+  interface.print(F(","));
+  interface.println(block_checksum);
+}
@@ -0,0 +1,63 @@
+/*
+Vrekrer_scpi_parser library.
+Buffered response example.
+
+Demonstrates how to use a response buffer.
+The responses of a message are stored in the buffer and sent in a single
+write after the message is executed (or when the buffer is full), so a
+query like MEAS:ALL? is sent in one USB or Ethernet packet instead of one
+packet per print call.
+
+Commands:
+  *IDN?
+    Gets the instrument's identification string
+
+  MEASure:ALL?
+    Queries the value of all the analog inputs, e.g. "512,498,1023,0,12,7"
+
+  MEASure:VOLTage?
+    Queries the voltage of the analog input 0
+    e.g. "MEAS:ALL?;MEAS:VOLT?" returns "512,498,1023,0,12,7;2.50"
+*/
+
+//The response buffer is allocated in the stack while executing a message
+//See the Configuration_Options example for further information.
+#define SCPI_RESPONSE_BUFFER_LENGTH 64  //default 0
+
+#include "Arduino.h"
+#include "Vrekrer_scpi_parser.h"
+
+SCPI_Parser my_instrument;
+
+void setup()
+{
+  my_instrument.RegisterCommand(F("*IDN?"), &Identify);
+  my_instrument.SetCommandTreeBase(F("MEASure"));
+    my_instrument.RegisterCommand(F(":ALL?"), &MeasureAll);
+    my_instrument.RegisterCommand(F(":VOLTage?"), &MeasureVoltage);
+
+  Serial.begin(9600);
+}
+
+void loop()
+{
+  my_instrument.ProcessInput(Serial, "\n");
+}
+
+void Identify(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  //Print calls are also buffered
+  interface.println(F("Vrekrer,SCPI Buffered Response Example,#00,"
+                      VREKRER_SCPI_VERSION));
+}
+
+void MeasureAll(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  //The interface is a SCPI_Response when SCPI_RESPONSE_BUFFER_LENGTH > 0
+  SCPI_Response& response = static_cast<SCPI_Response&>(interface);
+  //Data elements are separated by ',' and the response ends with '\n'
+  for (int pin = 0; pin < 6; pin++) response.Add(analogRead(A0 + pin));
+}
+
+void MeasureVoltage(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  SCPI_Response& response = static_cast<SCPI_Response&>(interface);
+  response.Add(analogRead(A0) * 5.0 / 1023, 2);
+}
@@ -0,0 +1,102 @@
+/*
+Vrekrer_scpi_parser library.
+Compile time command table example.
+
+Demonstrates how to declare the whole command tree at compile time.
+The tokens, the commands' hashes and the handlers are stored in flash, so no
+RAM is used for them and nothing is registered at boot time.
+Unknown tokens and hash crashes are reported as compile errors.
+
+Commands:
+  *IDN?
+    Gets the instrument's identification string
+
+  SYSTem:LED:BRIGhtness <value>
+    Sets the LED's brightness to <value>
+    Valid values : 0 (OFF) to 10 (Full brightness)
+
+  SYSTem:LED:BRIGhtness?
+    Queries the current LED's brightness value
+
+  DOut<index> HIGH|LOW
+    Sets the logic state of DOut<index> (pin 2 + index)
+*/
+
+//Enables SCPI_MakeConstTable and SCPI_Parser::SetCommandTable
+#define SCPI_CONST_TABLE 1
+//The tokens and commands are not stored in RAM
+#define SCPI_MAX_TOKENS 0
+#define SCPI_MAX_COMMANDS 0
+
+#include "Arduino.h"
+#include "Vrekrer_scpi_parser.h"
+
+const int ledPin = LED_BUILTIN;
+int brightness = 0;
+
+void Identify(SCPI_C commands, SCPI_P parameters, Stream& interface);
+void SetBrightness(SCPI_C commands, SCPI_P parameters, Stream& interface);
+void GetBrightness(SCPI_C commands, SCPI_P parameters, Stream& interface);
+void WriteDigital_Output(SCPI_C commands, SCPI_P parameters,
+                         Stream& interface);
+
+//Colon separated list of the valid tokens
+const char tokens[] PROGMEM = "*IDN:SYSTem:LED:BRIGhtness:DOut#";
+
+//Commands and handlers, they must use the tokens listed above
+constexpr SCPI_Const_Command commands[] = {
+  {"*IDN?", &Identify},
+  {"SYSTem:LED:BRIGhtness", &SetBrightness},
+  {"SYSTem:LED:BRIGhtness?", &GetBrightness},
+  {"DOut#", &WriteDigital_Output},
+};
+
+//The hashes are calculated and sorted by the compiler
+constexpr auto command_table PROGMEM = SCPI_MakeConstTable(tokens, commands);
+
+SCPI_Parser my_instrument;
+
+void setup()
+{
+  my_instrument.SetCommandTable(command_table);
+  pinMode(ledPin, OUTPUT);
+  for (int i = 2; i < 8; i++) pinMode(i, OUTPUT);
+  Serial.begin(9600);
+}
+
+void loop()
+{
+  my_instrument.ProcessInput(Serial, "\n");
+  analogWrite(ledPin, brightness*25);
+}
+
+void Identify(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  interface.println(F("Vrekrer,SCPI Command table example,#00,"
+                      VREKRER_SCPI_VERSION));
+}
+
+void SetBrightness(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  if (parameters.Size() > 0) {
+    brightness = constrain(String(parameters[0]).toInt(), 0, 10);
+  }
+}
+
+void GetBrightness(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  interface.println(String(brightness, DEC));
+}
+
+void WriteDigital_Output(SCPI_C commands, SCPI_P parameters,
+                         Stream& interface) {
+  //Get the numeric suffix/index (if any) from the commands
+  String header = String(commands.Last());
+  header.toUpperCase();
+  int suffix = -1;
+  sscanf(header.c_str(),"%*[DOUT]%u", &suffix);
+
+  String first_parameter = String(parameters.First());
+  first_parameter.toUpperCase();
+  if ( (suffix >= 0) && (suffix < 6) ) {
+    if (first_parameter == "HIGH") digitalWrite(2 + suffix, HIGH);
+    else if (first_parameter == "LOW") digitalWrite(2 + suffix, LOW);
+  }
+}
@@ -8,12 +8,31 @@ Vrekrer_scpi_parser library is designed for reduced RAM usage, needed for low
 RAM microcontrollers.
 You can fine tune, or expand the default library capabilities by defining 
 (before the library include)  the following macros:
-SCPI_ARRAY_SYZE : Max branches of the command tree and max number of parameters.
+SCPI_ARRAY_SYZE : Default of SCPI_MAX_COMMAND_DEPTH and SCPI_MAX_PARAMETERS.
+SCPI_MAX_COMMAND_DEPTH : Max branches of the command tree.
+SCPI_MAX_PARAMETERS : Max number of parameters.
 SCPI_MAX_TOKENS : Max number of valid tokens.
+SCPI_TOKEN_BUFFER_LENGTH : Length of the tokens' storage.
 SCPI_MAX_COMMANDS : Max number of registered commands.
 SCPI_MAX_SPECIAL_COMMANDS : Max number of special commands.
 SCPI_BUFFER_LENGTH : Length of the message buffer.
+SCPI_RECEIVE_BUFFER_LENGTH : Length of the receive buffer.
+SCPI_RESPONSE_BUFFER_LENGTH : Length of the response buffer.
+SCPI_BLOCK_DATA : Enables IEEE 488.2 arbitrary block parameters.
+SCPI_MAX_OPERATIONS : Max number of pending overlapped operations.
+SCPI_WAIT_QUEUE_LENGTH : Length of the queue used while waiting (*WAI).
+SCPI_MAX_STREAMS : Max number of pending streamed responses.
+SCPI_STREAM_CHUNK_LENGTH : Max chars requested to a stream producer per call.
+SCPI_ERROR_QUEUE_LENGTH : Number of entries of the SCPI error queue.
+SCPI_ERROR_CONTEXT_LENGTH : Max length of the context of the queued errors.
+SCPI_STATISTICS : Enables the runtime statistics.
+SCPI_HEADER_CACHE : Number of entries of the header cache.
+SCPI_HEADER_CACHE_KEY_LENGTH : Max length of the cached headers.
+SCPI_HANDLER_CONTEXT : Enables the handlers with a user context.
 SCPI_HASH_TYPE : Integer size used for hashes.
+SCPI_HASH_SEARCH : Enables the automatic search of crash free magic numbers.
+SCPI_CONST_TABLE : Enables compile time command tables (stored in flash).
+SCPI_OPTIONAL_NODES : Enables optional nodes ([:KEYWord]) in the commands.
 */
 
 /*
@@ -54,8 +73,14 @@ SYSTem
 Largest branch needed = 3
 i.e. STATus:OPERation:ENABle or SYSTem:ERRor:NEXT?
 */
-#define SCPI_ARRAY_SYZE 3 //Default value = 6
-//This also sets the max number of parameters
+#define SCPI_MAX_COMMAND_DEPTH 3 //Default value = SCPI_ARRAY_SYZE (6)
+
+/*
+Max number of parameters needed = 1
+i.e. *ESE 32
+*/
+#define SCPI_MAX_PARAMETERS 1 //Default value = SCPI_ARRAY_SYZE (6)
+//SCPI_ARRAY_SYZE sets both values
 
 /*
 Valid Tokens: 
@@ -84,6 +109,12 @@ Total number of valid tokens: 21
 */
 #define SCPI_MAX_TOKENS 21 //Default value = 15
 
+/*
+The tokens are stored (in upper case, one extra char per token) in a fixed
+size buffer. The tokens listed above need 136 chars.
+*/
+#define SCPI_TOKEN_BUFFER_LENGTH 136 //Default value = SCPI_MAX_TOKENS * 10
+
 /*
 Valid Commands:
 01: STATus:OPERation:CONDition?
@@ -129,6 +160,100 @@ will need at least 67 byte buffer length.
 */
 #define SCPI_BUFFER_LENGTH 128 //Default value = 64
 
+/*
+By default the chars are read from the interface one by one. With a receive
+buffer, the available chars are read in chunks (readBytes) and several
+pipelined messages can be stored. Use ProcessAllInput to execute all the
+received messages in one call.
+*/
+#define SCPI_RECEIVE_BUFFER_LENGTH 0 //Default value = 0
+
+/*
+By default the commands write their responses directly to the interface.
+With a response buffer (allocated in the stack while executing a message),
+the responses of a message are sent in a single write, and the commands can
+use SCPI_Response to format them. See Buffered_Response example.
+*/
+#define SCPI_RESPONSE_BUFFER_LENGTH 0 //Default value = 0
+
+/*
+With SCPI_BLOCK_DATA defined as 1, a message unit whose last parameter is an
+arbitrary block (#<n><length><data> or #0<data>) is not copied to the message
+buffer. The handler reads the block data from its interface argument.
+See Block_Data example for further details.
+*/
+#define SCPI_BLOCK_DATA 0 //Default value = 0
+
+/*
+With SCPI_MAX_OPERATIONS greater than 0, the commands can start overlapped
+operations (SCPI_Parser::StartOperation) that are polled from loop(), and
+the parser implements *OPC, *OPC? and *WAI. The messages received while
+waiting for the operations (after *WAI or *OPC?) are stored in a queue of
+SCPI_WAIT_QUEUE_LENGTH bytes, each message also uses a pointer and its
+header path (about 16 bytes).
+See Overlapped_Commands example for further details.
+*/
+#define SCPI_MAX_OPERATIONS 0 //Default value = 0
+#define SCPI_WAIT_QUEUE_LENGTH 128 //Default value = SCPI_BUFFER_LENGTH
+
+/*
+With SCPI_MAX_STREAMS greater than 0, queries can start streamed responses
+(SCPI_Parser::StreamResponse). The data is requested to a producer procedure
+in chunks of up to SCPI_STREAM_CHUNK_LENGTH chars (a buffer in the stack), 
+and only the chars that the interface accepts (availableForWrite) are 
+written on each ProcessInput call (interfaces that always report 0 are 
+written with blocking writes).
+Each pending streamed response uses 2 pointers + 24 bytes of RAM.
+See Streamed_Response example for further details.
+*/
+#define SCPI_MAX_STREAMS 0 //Default value = 0
+#define SCPI_STREAM_CHUNK_LENGTH 32 //Default value = 32
+
+/*
+With SCPI_ERROR_QUEUE_LENGTH defined as N > 0, the errors are also stored,
+with their SCPI-99 code (e.g. -113 for unknown commands), in a queue of N 
+entries (up to 255) that is read with SYSTem:ERRor? (see PrintNextError).
+If the queue is full its last error is replaced by -350 (Queue overflow).
+With SCPI_ERROR_CONTEXT_LENGTH > 0, each entry also stores the start of the
+header or parameter that caused the error.
+Each entry uses 2 + SCPI_ERROR_CONTEXT_LENGTH + 1 (if > 0) bytes of RAM.
+See Error_Queue example for further details.
+*/
+#define SCPI_ERROR_QUEUE_LENGTH 0 //Default value = 0
+#define SCPI_ERROR_CONTEXT_LENGTH 0 //Default value = 0
+
+/*
+With SCPI_STATISTICS defined as 1, the parser counts the calls and measures
+the execution and parsing times (micros) of every registered command, and 
+also keeps the parsing time of all the commands, the number of errors of 
+each type and the longest message and parameter list. This needs 20 bytes 
+of RAM per command, and a few micros calls per message unit. See Statistics example for further details.
+*/
+#define SCPI_STATISTICS 0 //Default value = 0
+
+/*
+Instruments are often polled with the same few queries (e.g. MEAS:VOLT?).
+With SCPI_HEADER_CACHE defined as N > 0, the last headers received are kept
+in a cache of N entries, and a repeated header gets its command without
+hashing its keywords again. Each entry uses about
+SCPI_HEADER_CACHE_KEY_LENGTH + 2 + sizeof(SCPI_HASH_TYPE) 
++ 2 * SCPI_MAX_COMMAND_DEPTH bytes of RAM.
+Longer headers are not cached. The cache is not used after Freeze().
+header_cache_hits and header_cache_misses count the cache lookups.
+*/
+#define SCPI_HEADER_CACHE 0 //Default value = 0
+#define SCPI_HEADER_CACHE_KEY_LENGTH 16 //Default value = 16
+
+/*
+With SCPI_HANDLER_CONTEXT defined as 1, commands can also be registered with
+a context handler and a void* context, e.g. an object of a class.
+Context handlers receive the commands and parameters by reference and the
+context pointer. SCPI_Method<Class, &Class::Method> calls a member function
+on the context object. This needs 2 pointers of RAM per command.
+See Handler_Context example for further details.
+*/
+#define SCPI_HANDLER_CONTEXT 0 //Default value = 0
+
 /*
 In order to reduce RAM usage, Vrekrer_scpi_parser library (ver. 0.42 and later)
 uses a hash algorithm to store and compare registered commands. In very rare 
@@ -138,11 +263,62 @@ If needed, to avoid hash crashes, change SCPI_HASH_TYPE to uint16_t or uint32_t
 */
 #define SCPI_HASH_TYPE uint8_t //Default value = uint8_t
 
+/*
+Hash crashes are reported by PrintDebugInfo. Alternatively, with 
+SCPI_HASH_SEARCH defined as 1, SCPI_Parser::FixHashCrashes() can be called
+after registering all the commands to search crash free magic numbers
+automatically. This needs extra RAM to store the tokens of every command
+(about SCPI_MAX_COMMANDS * (SCPI_MAX_COMMAND_DEPTH + 2) bytes).
+*/
+#define SCPI_HASH_SEARCH 0 //Default value = 0
+
+/*
+With SCPI_CONST_TABLE defined as 1, the whole command tree can be declared at
+compile time (see the Command_Table example). The tokens, hashes and handlers
+are then stored in flash, and no RAM or boot time is used to register them.
+*/
+#define SCPI_CONST_TABLE 0 //Default value = 0
+
+/*
+With SCPI_OPTIONAL_NODES defined as 1, the registered commands can contain
+optional nodes in square brackets, e.g. "MEASure[:SCALar]:VOLTage[:DC]?".
+It is registered once (one SCPI_MAX_COMMANDS slot), instead of once for each
+of its four forms. The keywords of its optional nodes are not hashed, and
+they may only be omitted in the commands where they are in brackets (a 
+"SYSTem:DC?" command still needs its DC keyword).
+This needs (SCPI_MAX_TOKENS / 8 + 1) * (SCPI_MAX_COMMANDS + 2) + 1 bytes of
+RAM. Not used by command tables.
+See Optional_Nodes example for further details.
+*/
+#define SCPI_OPTIONAL_NODES 0 //Default value = 0
+
 #include "Arduino.h"
 #include "Vrekrer_scpi_parser.h"
 
 SCPI_Parser my_instrument;
 
+/*
+The sizes above (SCPI_MAX_TOKENS, SCPI_BUFFER_LENGTH, SCPI_MAX_OPERATIONS...)
+are the sizes of SCPI_Parser. Parsers with other sizes can be used in the 
+same program, e.g. a small one for a debug port:
+
+struct Debug_Config : SCPI_Parser_Config {
+  static const uint8_t max_tokens = 4;
+  static const uint16_t token_buffer_length = 32;
+  static const uint8_t max_commands = 4;
+  using hash_type = uint8_t;
+  static const scpi_length_t buffer_length = 24;
+  static const uint8_t max_command_depth = 2;
+  static const uint8_t max_parameters = 1;
+};
+SCPI_Basic_Parser<Debug_Config> debug_port;
+SCPI_Basic_Parser<Debug_Config>::session_t debug_session;
+
+See SCPI_Parser_Config for the list of sizes. SCPI_MAX_COMMAND_DEPTH, 
+SCPI_MAX_PARAMETERS and SCPI_BUFFER_LENGTH are also the largest sizes a 
+configuration can use. The other options are shared by all the parsers.
+*/
+
 
 void setup() {
   /*
@@ -16,6 +16,8 @@ Commands:
 
   SYSTem:ERRor?
     Reads the last error occurred and then delete it.
+
+See the Error_Queue example to keep all the errors (SCPI-99 error queue).
 */
 
 
@@ -61,6 +63,21 @@ void GetLastEror(SCPI_C commands, SCPI_P parameters, Stream& interface) {
     case my_instrument.ErrorCode::UnknownCommand:
       interface.println(F("Unknown command received"));
       break;
+    case my_instrument.ErrorCode::MissingParameter:
+      interface.println(F("Missing parameter"));
+      break;
+    case my_instrument.ErrorCode::InvalidParameter:
+      interface.println(F("Invalid parameter"));
+      break;
+    case my_instrument.ErrorCode::OutOfRange:
+      interface.println(F("Parameter out of range"));
+      break;
+    case my_instrument.ErrorCode::QueryInterrupted:
+      interface.println(F("Streamed response interrupted"));
+      break;
+    case my_instrument.ErrorCode::OperationIgnored:
+      interface.println(F("Overlapped operation not started"));
+      break;
     case my_instrument.ErrorCode::NoError:
       interface.println(F("No Error"));
       break;
@@ -77,6 +94,19 @@ void myErrorHandler(SCPI_C commands, SCPI_P parameters, Stream& interface) {
        SCPI_Parser::ErrorCode::UnknownCommand
        SCPI_Parser::ErrorCode::Timeout
        SCPI_Parser::ErrorCode::BufferOverflow
+       SCPI_Parser::ErrorCode::MissingParameter
+       SCPI_Parser::ErrorCode::InvalidParameter
+       SCPI_Parser::ErrorCode::OutOfRange
+       SCPI_Parser::ErrorCode::QueryInterrupted
+       SCPI_Parser::ErrorCode::OperationIgnored
+     MissingParameter, InvalidParameter and OutOfRange are reported by the 
+     parameter decoders (GetInteger, GetReal, GetBoolean and GetChoice), see
+     the Typed_Parameters example.
+     QueryInterrupted is reported when a message interrupts a streamed 
+     response, see the Streamed_Response example.
+     OperationIgnored is only set in last_error (the error handler is not
+     called), when StartOperation has no room for a new operation, see the
+     Overlapped_Commands example.
   */
 
   /* For BufferOverflow errors, the rest of the message, still in the interface
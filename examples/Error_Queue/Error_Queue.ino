@@ -0,0 +1,85 @@
+/*
+Vrekrer_scpi_parser library.
+SCPI error queue example.
+
+Demonstrates how to use the SCPI-99 error queue.
+The errors are stored (with their SCPI error code and context) in a queue
+of SCPI_ERROR_QUEUE_LENGTH entries, and read later, oldest first, with
+SYSTem:ERRor? (no error handler is needed).
+If the queue is full the last error is replaced by -350,"Queue overflow".
+
+Hardware required: None
+
+Commands:
+  *IDN?
+    Gets the instrument's identification string
+
+  *CLS
+    Clears the error queue
+
+  SOURce:VOLTage <value>
+    Sets the output voltage, from 0 V to 5 V
+    e.g. "SOUR:VOLT 7" queues -222,"Data out of range;7"
+
+  SYSTem:ERRor?
+  SYSTem:ERRor:NEXT?
+    Reads the oldest error and then delete it, e.g. -113,"Undefined header;FOO"
+    0,"No error" is returned when the queue is empty.
+
+  SYSTem:ERRor:COUNt?
+    Queries the number of errors in the queue
+*/
+
+//Enables the error queue, and stores up to 16 chars of context per error
+//See the Configuration_Options example for further information.
+#define SCPI_ERROR_QUEUE_LENGTH 8  //default 0
+#define SCPI_ERROR_CONTEXT_LENGTH 16  //default 0
+
+#include "Arduino.h"
+#include "Vrekrer_scpi_parser.h"
+
+SCPI_Parser my_instrument;
+float voltage = 0;
+
+void setup()
+{
+  my_instrument.RegisterCommand(F("*IDN?"), &Identify);
+  my_instrument.RegisterCommand(F("*CLS"), &ClearStatus);
+  my_instrument.RegisterCommand(F("SOURce:VOLTage"), &SetVoltage);
+  my_instrument.RegisterCommand(F("SYSTem:ERRor?"), &GetError);
+  my_instrument.SetCommandTreeBase(F("SYSTem:ERRor"));
+    my_instrument.RegisterCommand(F(":NEXT?"), &GetError);
+    my_instrument.RegisterCommand(F(":COUNt?"), &GetErrorCount);
+
+  Serial.begin(9600);
+}
+
+void loop()
+{
+  my_instrument.ProcessInput(Serial, "\n");
+  //Device-specific errors use positive codes
+  if (analogRead(A0) > 1000) my_instrument.PushError(201, "Input overload");
+}
+
+void Identify(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  interface.println(F("Vrekrer,SCPI Error Queue Example,#00,"
+                      VREKRER_SCPI_VERSION));
+}
+
+void ClearStatus(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  my_instrument.ClearErrors();
+}
+
+void SetVoltage(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  //Invalid or out of range values are queued by GetReal
+  my_instrument.GetReal(parameters, 0, voltage, 0.0, 5.0, "V", interface);
+}
+
+void GetError(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  //Prints and removes the oldest error of the queue
+  my_instrument.PrintNextError(interface);
+}
+
+void GetErrorCount(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  interface.println(my_instrument.ErrorCount());
+}
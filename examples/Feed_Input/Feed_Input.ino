@@ -0,0 +1,57 @@
+/*
+Vrekrer_scpi_parser library.
+Feed input example.
+
+Demonstrates how to pass received data to the parser (push input), instead
+of letting it read the Stream interface (ProcessInput).
+This is useful when the data arrives in chunks, e.g. from a DMA buffer,
+an interrupt callback or a network event loop. Every complete message in
+the data is executed, partial messages are kept until the next chunk.
+Here the chunks are read from Serial into a local buffer.
+
+Hardware required: None
+
+Commands:
+  *IDN?
+    Gets the instrument's identification string
+
+  MEASure:VOLTage?
+    Queries the voltage of the analog input 0
+*/
+
+#include "Arduino.h"
+#include "Vrekrer_scpi_parser.h"
+
+SCPI_Parser my_instrument;
+//Stand-in for a DMA or network receive buffer
+char chunk[32];
+
+void setup()
+{
+  my_instrument.RegisterCommand(F("*IDN?"), &Identify);
+  my_instrument.RegisterCommand(F("MEASure:VOLTage?"), &MeasureVoltage);
+
+  Serial.begin(9600);
+}
+
+void loop()
+{
+  size_t length = 0;
+  int available = Serial.available();
+  if (available > 0) {
+    if (available > int(sizeof(chunk))) available = sizeof(chunk);
+    length = Serial.readBytes(chunk, available);
+  }
+  //The responses are written to Serial.
+  //Feeding 0 chars checks the timeout of partial messages.
+  my_instrument.Feed(chunk, length, Serial, "\n", millis());
+}
+
+void Identify(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  interface.println(F("Vrekrer,SCPI Feed Input Example,#00,"
+                      VREKRER_SCPI_VERSION));
+}
+
+void MeasureVoltage(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  interface.println(analogRead(A0) * 5.0 / 1023, 2);
+}
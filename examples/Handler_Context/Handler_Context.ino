@@ -0,0 +1,89 @@
+/*
+Vrekrer_scpi_parser library.
+Handler context example.
+
+Demonstrates how to register commands with a user context.
+The same member function of a class handles the commands of several
+objects, the object is passed to the handler as the context pointer.
+Context handlers receive the commands and parameters by reference, they are
+not copied on each call.
+
+Commands:
+  *IDN?
+    Gets the instrument's identification string
+
+  LED:RED:STATe ON|OFF|1|0
+  LED:GREen:STATe ON|OFF|1|0
+    Turns the led on or off
+
+  LED:RED:STATe?
+  LED:GREen:STATe?
+    Queries the led state
+*/
+
+//Enables the handlers with a user context
+//See the Configuration_Options example for further information.
+#define SCPI_HANDLER_CONTEXT 1  //default 0
+
+#include "Arduino.h"
+#include "Vrekrer_scpi_parser.h"
+
+SCPI_Parser my_instrument;
+
+class Led {
+ public:
+  Led(uint8_t pin) : pin_(pin) {}
+  void Begin() {
+    pinMode(pin_, OUTPUT);
+    digitalWrite(pin_, LOW);
+  }
+  void SetState(const SCPI_Commands& commands,
+                const SCPI_Parameters& parameters, Stream& interface) {
+    if (my_instrument.GetBoolean(parameters, 0, state_, interface))
+      digitalWrite(pin_, state_ ? HIGH : LOW);
+  }
+  void GetState(const SCPI_Commands& commands,
+                const SCPI_Parameters& parameters, Stream& interface) {
+    interface.println(state_ ? 1 : 0);
+  }
+ private:
+  uint8_t pin_;
+  bool state_ = false;
+};
+
+Led red_led(2);
+Led green_led(3);
+
+void setup()
+{
+  red_led.Begin();
+  green_led.Begin();
+
+  my_instrument.RegisterCommand(F("*IDN?"), &Identify);
+  //SCPI_Method<Class, &Class::Method> calls Method on the context object
+  my_instrument.SetCommandTreeBase(F("LED:RED"));
+    my_instrument.RegisterCommand(F(":STATe"),
+                                  &SCPI_Method<Led, &Led::SetState>, &red_led);
+    my_instrument.RegisterCommand(F(":STATe?"),
+                                  &SCPI_Method<Led, &Led::GetState>, &red_led);
+  my_instrument.SetCommandTreeBase(F("LED:GREen"));
+    my_instrument.RegisterCommand(F(":STATe"),
+                                  &SCPI_Method<Led, &Led::SetState>,
+                                  &green_led);
+    my_instrument.RegisterCommand(F(":STATe?"),
+                                  &SCPI_Method<Led, &Led::GetState>,
+                                  &green_led);
+
+  Serial.begin(9600);
+}
+
+void loop()
+{
+  my_instrument.ProcessInput(Serial, "\n");
+}
+
+//Handlers without a context keep the usual signature
+void Identify(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  interface.println(F("Vrekrer,SCPI Handler Context Example,#00,"
+                      VREKRER_SCPI_VERSION));
+}
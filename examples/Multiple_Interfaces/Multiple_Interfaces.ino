@@ -0,0 +1,58 @@
+/*
+Vrekrer_scpi_parser library.
+Multiple interfaces example.
+
+Demonstrates how to use one parser with several interfaces.
+Each interface needs its own SCPI_Session, which holds the message buffer
+and the partially received message, so the chars of a message received by
+one interface do not mix with the ones of the other.
+The registered commands are shared by all the sessions.
+
+This example needs a board with two serial ports (e.g. Arduino Mega or
+Leonardo), the same applies to Ethernet or WiFi clients.
+
+Commands:
+  *IDN?
+    Gets the instrument's identification string
+
+  DO:LED <value>
+    Turns the built-in LED on (1) or off (0)
+    e.g. DO:LED 1
+*/
+
+#include "Arduino.h"
+#include "Vrekrer_scpi_parser.h"
+
+SCPI_Parser my_instrument;
+//Session for Serial1, Serial uses the parser's internal session.
+//Each extra session uses SCPI_BUFFER_LENGTH bytes of RAM, plus the
+//receive buffer if SCPI_RECEIVE_BUFFER_LENGTH is used.
+SCPI_Session serial1_session;
+
+void setup()
+{
+  my_instrument.RegisterCommand(F("*IDN?"), &Identify);
+  my_instrument.RegisterCommand(F("DO:LED"), &SetLed);
+
+  Serial.begin(9600);
+  Serial1.begin(9600);
+  pinMode(LED_BUILTIN, OUTPUT);
+}
+
+void loop()
+{
+  my_instrument.ProcessInput(Serial, "\n");
+  my_instrument.ProcessInput(serial1_session, Serial1, "\n");
+}
+
+void Identify(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  //The response is sent to the interface that received the command
+  interface.println(F("Vrekrer,SCPI Multiple Interfaces Example,#00,"
+                      VREKRER_SCPI_VERSION));
+}
+
+void SetLed(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  long value = 0;
+  if (my_instrument.GetInteger(parameters, 0, value, 0, 1, interface))
+    digitalWrite(LED_BUILTIN, value);
+}
@@ -56,6 +56,7 @@ void setup()
   my_instrument.RegisterCommand("*IDN?", &Identify);
 
   //Use "#" at the end of a token to accept numeric suffixes.
+  //The suffixes are available in the procedures, see SCPI_Commands::Suffix
   my_instrument.RegisterCommand(F("DIn#?"), &QueryDigital_Input);
   my_instrument.RegisterCommand(F("DOut#"), &WriteDigital_Output);
   my_instrument.RegisterCommand(F("DOut#?"), &QueryDigital_Output);
@@ -88,14 +89,11 @@ void QueryDigital_Input(SCPI_C commands, SCPI_P parameters, Stream& interface) {
   // DIn0?     (Queries the state of DOut[0] pin)
   // DI5?      (Queries the state of DOut[5] pin)
 
-  //Get the numeric suffix/index (if any) from the commands
-  String header = String(commands.Last());
-  header.toUpperCase();
-  int suffix = -1;
-  sscanf(header.c_str(),"%*[DIN]%u", &suffix);
+  //Get the numeric suffix/index of the first keyword (1 if omitted)
+  uint16_t suffix = commands.Suffix(0);
 
   //If the suffix is valid, print the pin's logic state to the interface
-  if ( (suffix >= 0) && (suffix < 6) ) {
+  if (suffix < 6) {
     if (digitalRead(DIn[suffix]) == HIGH) {
       interface.println("HIGH");
     } else { //LOW
@@ -112,14 +110,11 @@ void QueryDigital_Output(SCPI_C commands, SCPI_P parameters, Stream& interface)
   // DO4?      (Queries the state of DOut[4] pin)
   // DOut6?    (This does nothing as DOut[6] does not exists)
 
-  //Get the numeric suffix/index (if any) from the commands
-  String header = String(commands.Last());
-  header.toUpperCase();
-  int suffix = -1;
-  sscanf(header.c_str(),"%*[DOUT]%u", &suffix);
+  //Get the numeric suffix/index of the first keyword (1 if omitted)
+  uint16_t suffix = commands.Suffix(0);
 
   //If the suffix is valid, print the pin's logic value to the interface
-  if ( (suffix >= 0) && (suffix < 6) ) {
+  if (suffix < 6) {
     if (digitalRead(DOut[suffix]) == HIGH) {
       interface.println("HIGH");
     } else { //LOW
@@ -138,17 +133,14 @@ void WriteDigital_Output(SCPI_C commands, SCPI_P parameters, Stream& interface)
   // DO2 Off     (Sets DOut[2] to LOW)
   // DOUT0 1     (Sets DOut[0] to HIGH)
 
-  //Get the numeric suffix/index (if any) from the commands
-  String header = String(commands.Last());
-  header.toUpperCase();
-  int suffix = -1;
-  sscanf(header.c_str(),"%*[DOUT]%u", &suffix);
+  //Get the numeric suffix/index of the first keyword (1 if omitted)
+  uint16_t suffix = commands.Suffix(0);
 
   //If the suffix is valid,
   //use the first parameter (if valid) to set the digital Output
   String first_parameter = String(parameters.First());
   first_parameter.toUpperCase();
-  if ( (suffix >= 0) && (suffix < 6) ) {
+  if (suffix < 6) {
     if ( (first_parameter == "HIGH")
        || (first_parameter == "ON")
        || (first_parameter == "1") ) {
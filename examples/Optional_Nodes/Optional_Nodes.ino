@@ -0,0 +1,89 @@
+/*
+Vrekrer_scpi_parser library.
+Optional nodes example.
+
+Demonstrates how to register commands with SCPI optional nodes.
+The keywords in square brackets can be omitted, and each command is
+registered once, e.g. "[SOURce]:VOLTage[:LEVel][:IMMediate][:AMPLitude]"
+accepts "VOLT 1", "SOUR:VOLT 1", "VOLT:LEV 1", "sour:volt:lev:imm:ampl 1",
+etc. using one of the SCPI_MAX_COMMANDS slots (instead of 16).
+A keyword is only optional in the commands where it is in brackets, e.g.
+"MEAS:AC?" is not accepted for "MEASure[:SCALar]:VOLTage:AC?".
+
+Hardware required: None
+
+Commands:
+  *IDN?
+    Gets the instrument's identification string
+
+  [SOURce]:VOLTage[:LEVel][:IMMediate][:AMPLitude] <value>
+    Sets the output voltage, from 0 V to 5 V
+
+  [SOURce]:VOLTage[:LEVel][:IMMediate][:AMPLitude]?
+    Queries the output voltage
+
+  MEASure[:SCALar]:VOLTage[:DC]?
+    Queries the DC voltage of the analog input 0
+
+  MEASure[:SCALar]:VOLTage:AC?
+    Queries the AC voltage (peak to peak) of the analog input 0
+*/
+
+//Enables the optional nodes
+//See the Configuration_Options example for further information.
+#define SCPI_OPTIONAL_NODES 1  //default 0
+
+#include "Arduino.h"
+#include "Vrekrer_scpi_parser.h"
+
+SCPI_Parser my_instrument;
+float voltage = 0;
+
+void setup()
+{
+  my_instrument.RegisterCommand(F("*IDN?"), &Identify);
+  //The TreeBase can also contain optional nodes
+  my_instrument.SetCommandTreeBase(F("[SOURce]:VOLTage"));
+    my_instrument.RegisterCommand(F("[:LEVel][:IMMediate][:AMPLitude]"),
+                                  &SetVoltage);
+    my_instrument.RegisterCommand(F("[:LEVel][:IMMediate][:AMPLitude]?"),
+                                  &GetVoltage);
+  my_instrument.SetCommandTreeBase(F("MEASure[:SCALar]:VOLTage"));
+    my_instrument.RegisterCommand(F("[:DC]?"), &MeasureDC);
+    my_instrument.RegisterCommand(F(":AC?"), &MeasureAC);
+
+  Serial.begin(9600);
+}
+
+void loop()
+{
+  my_instrument.ProcessInput(Serial, "\n");
+}
+
+void Identify(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  interface.println(F("Vrekrer,SCPI Optional Nodes Example,#00,"
+                      VREKRER_SCPI_VERSION));
+}
+
+void SetVoltage(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  my_instrument.GetReal(parameters, 0, voltage, 0.0, 5.0, "V", interface);
+}
+
+void GetVoltage(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  interface.println(voltage, 2);
+}
+
+void MeasureDC(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  interface.println(analogRead(A0) * 5.0 / 1023, 2);
+}
+
+void MeasureAC(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  int min_value = 1023;
+  int max_value = 0;
+  for (int i = 0; i < 100; i++) {
+    int value = analogRead(A0);
+    if (value < min_value) min_value = value;
+    if (value > max_value) max_value = value;
+  }
+  interface.println((max_value - min_value) * 5.0 / 1023, 2);
+}
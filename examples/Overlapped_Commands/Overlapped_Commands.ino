@@ -0,0 +1,91 @@
+/*
+Vrekrer_scpi_parser library.
+Overlapped commands example.
+
+Demonstrates how to execute slow commands without blocking the parser.
+The INITiate command starts a slow acquisition and returns immediately, the
+acquisition is polled from loop() while new commands are received.
+IEEE 488.2 *OPC, *OPC? and *WAI wait for the pending operations.
+
+Commands:
+  *IDN?
+    Gets the instrument's identification string
+
+  INITiate
+    Starts an acquisition (it takes 2 seconds)
+
+  FETCh?
+    Queries the last acquired value
+
+  *WAI
+    The following commands are executed after the pending operations
+    e.g. "INIT;*WAI;FETC?" returns the new value after 2 seconds
+
+  *OPC?
+    Returns 1 when the pending operations are completed
+
+  *OPC
+    Sets the operation complete flag when the pending operations are completed
+
+  *ESR?
+    Queries the operation complete flag (bit 0) and clears it
+*/
+
+//Enables the overlapped operations (and *OPC, *OPC? and *WAI)
+//See the Configuration_Options example for further information.
+#define SCPI_MAX_OPERATIONS 2  //default 0
+
+#include "Arduino.h"
+#include "Vrekrer_scpi_parser.h"
+
+SCPI_Parser my_instrument;
+unsigned long acquisition_start = 0;
+int acquired_value = 0;
+
+void setup()
+{
+  my_instrument.RegisterCommand(F("*IDN?"), &Identify);
+  my_instrument.RegisterCommand(F("*ESR?"), &GetEventStatus);
+  my_instrument.RegisterCommand(F("INITiate"), &Initiate);
+  my_instrument.RegisterCommand(F("FETCh?"), &Fetch);
+
+  Serial.begin(9600);
+}
+
+void loop()
+{
+  //Also polls the pending operations
+  my_instrument.ProcessInput(Serial, "\n");
+}
+
+void Identify(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  interface.println(F("Vrekrer,SCPI Overlapped Commands Example,#00,"
+                      VREKRER_SCPI_VERSION));
+}
+
+void GetEventStatus(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  interface.println(my_instrument.operation_complete ? 1 : 0);
+  my_instrument.operation_complete = false;
+}
+
+/*
+## Overlapped operation. ##
+Returns true when the operation is completed, it is called repeatedly by 
+ProcessInput (or PollOperations) until then.
+*/
+bool AcquisitionDone() {
+  if (millis() - acquisition_start < 2000) return false;
+  acquired_value = analogRead(A0);
+  return true;
+}
+
+void Initiate(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  acquisition_start = millis();
+  //Returns false (OperationIgnored error) if the acquisitions of 
+  //SCPI_MAX_OPERATIONS previous INIT commands are still pending
+  my_instrument.StartOperation(&AcquisitionDone);
+}
+
+void Fetch(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  interface.println(acquired_value);
+}
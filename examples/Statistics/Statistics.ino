@@ -0,0 +1,76 @@
+/*
+Vrekrer_scpi_parser library.
+Runtime statistics example.
+
+Demonstrates how to profile a device without a debugger.
+With SCPI_STATISTICS enabled the parser counts the calls and measures the
+execution and parsing times of every registered command (the parsing time
+is not included in the execution time), the errors (also the ones raised
+while receiving, e.g. timeouts) and the longest message and parameter list.
+
+Commands:
+  *IDN?
+    Gets the instrument's identification string
+
+  MEASure:SLOW?
+    A slow query (about 5 ms)
+
+  SYSTem:STATistics?
+    Queries the statistics as a list of numbers
+    (see SCPI_Parser::PrintStatisticsList)
+
+  SYSTem:STATistics:PRINt
+    Prints the statistics in a readable format
+
+  SYSTem:STATistics:RESet
+    Clears the statistics
+*/
+
+//Enables the runtime statistics
+//See the Configuration_Options example for further information.
+#define SCPI_STATISTICS 1  //default 0
+
+#include "Arduino.h"
+#include "Vrekrer_scpi_parser.h"
+
+SCPI_Parser my_instrument;
+
+void setup()
+{
+  my_instrument.RegisterCommand(F("*IDN?"), &Identify);
+  my_instrument.RegisterCommand(F("MEASure:SLOW?"), &MeasureSlow);
+  my_instrument.RegisterCommand(F("SYSTem:STATistics?"), &GetStatistics);
+  my_instrument.SetCommandTreeBase(F("SYSTem:STATistics"));
+    my_instrument.RegisterCommand(F(":PRINt"), &PrintStatistics);
+    my_instrument.RegisterCommand(F(":RESet"), &ResetStatistics);
+
+  Serial.begin(9600);
+}
+
+void loop()
+{
+  my_instrument.ProcessInput(Serial, "\n");
+}
+
+void Identify(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  interface.println(F("Vrekrer,SCPI Statistics Example,#00,"
+                      VREKRER_SCPI_VERSION));
+}
+
+void MeasureSlow(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  delay(5);
+  interface.println(analogRead(A0));
+}
+
+void GetStatistics(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  my_instrument.PrintStatisticsList(interface);
+}
+
+void PrintStatistics(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  //Hashes of the commands are listed by PrintDebugInfo
+  my_instrument.PrintStatistics(interface);
+}
+
+void ResetStatistics(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  my_instrument.ResetStatistics();
+}
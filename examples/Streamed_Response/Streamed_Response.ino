@@ -0,0 +1,97 @@
+/*
+Vrekrer_scpi_parser library.
+Streamed response example.
+
+Demonstrates how to return large query results without building them in RAM
+and without blocking the parser.
+The queries start a streamed response and return immediately. The data is
+requested to a producer procedure in small chunks, and only the chars that
+Serial accepts without blocking (availableForWrite) are written on each
+ProcessInput call, while the other work of loop() continues.
+
+Hardware required: None
+
+Commands:
+  *IDN?
+    Gets the instrument's identification string
+
+  TRACe:ACQuire
+    Acquires 200 readings of the analog input 0
+
+  TRACe:DATA?
+    Queries the readings as an IEEE 488.2 arbitrary block of 400 bytes
+    (16 bit little endian values), e.g. "#3400<data>"
+
+  FETCh:ARRay?
+    Queries the readings as text, e.g. "0512,0511,0513,..."
+*/
+
+//Enables the streamed responses
+//See the Configuration_Options example for further information.
+#define SCPI_MAX_STREAMS 1  //default 0
+
+#include "Arduino.h"
+#include "Vrekrer_scpi_parser.h"
+
+SCPI_Parser my_instrument;
+const uint16_t trace_length = 200;
+uint16_t trace[trace_length];
+
+void setup()
+{
+  my_instrument.RegisterCommand(F("*IDN?"), &Identify);
+  my_instrument.SetCommandTreeBase(F("TRACe"));
+    my_instrument.RegisterCommand(F(":ACQuire"), &Acquire);
+    my_instrument.RegisterCommand(F(":DATA?"), &GetTraceData);
+  my_instrument.SetCommandTreeBase(F(""));
+  my_instrument.RegisterCommand(F("FETCh:ARRay?"), &FetchArray);
+
+  Serial.begin(9600);
+}
+
+void loop()
+{
+  //Also writes the pending streamed responses
+  my_instrument.ProcessInput(Serial, "\n");
+}
+
+void Identify(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  interface.println(F("Vrekrer,SCPI Streamed Response Example,#00,"
+                      VREKRER_SCPI_VERSION));
+}
+
+void Acquire(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  for (uint16_t i = 0; i < trace_length; i++) trace[i] = analogRead(A0);
+}
+
+//Producer of the binary data, the chars are read from the trace
+size_t TraceBytes(char* buffer, size_t size, uint32_t position) {
+  memcpy(buffer, (const char*)trace + position, size);
+  return size;
+}
+
+void GetTraceData(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  //Returns false (nothing is sent) if SCPI_MAX_STREAMS responses are 
+  //pending, not possible here with only one interface
+  my_instrument.StreamResponse(interface, &TraceBytes, sizeof(trace), true);
+}
+
+//Producer of the text data, each value uses 5 chars ("0512,")
+size_t TraceText(char* buffer, size_t size, uint32_t position) {
+  for (size_t i = 0; i < size; i++, position++) {
+    uint16_t value = trace[position / 5];
+    switch (position % 5) {
+      case 0: buffer[i] = '0' + value / 1000; break;
+      case 1: buffer[i] = '0' + value / 100 % 10; break;
+      case 2: buffer[i] = '0' + value / 10 % 10; break;
+      case 3: buffer[i] = '0' + value % 10; break;
+      default: buffer[i] = ',';
+    }
+  }
+  return size;
+}
+
+void FetchArray(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  //The last ',' is not sent
+  my_instrument.StreamResponse(interface, &TraceText, trace_length * 5 - 1);
+}
@@ -0,0 +1,109 @@
+/*
+Vrekrer_scpi_parser library.
+Typed parameters example.
+
+Demonstrates how to decode numeric, boolean and character parameters
+without using the String class.
+Invalid and out of range parameters are reported to the error handler.
+
+Commands:
+  SOURce:VOLTage <value>|MINimum|MAXimum|DEFault
+    Sets the output voltage, from 0 V to 5 V (default 1 V)
+    Units with multipliers are accepted, e.g. "2.5", "250 mV", "1.5E-1 V"
+
+  SOURce:VOLTage?
+    Queries the output voltage
+
+  OUTPut:STATe ON|OFF|1|0
+    Enables or disables the output
+
+  TRIGger:COUNt <count>|MINimum|MAXimum|DEFault
+    Sets the trigger count, from 1 to 1000 (default 1)
+
+  TRIGger:SOURce BUS|IMMediate|EXTernal
+    Sets the trigger source
+
+  SYSTem:ERRor?
+    Reads the last error and then delete it.
+*/
+
+#include "Arduino.h"
+#include "Vrekrer_scpi_parser.h"
+
+SCPI_Parser my_instrument;
+float voltage = 1.0;
+bool output_enabled = false;
+long trigger_count = 1;
+uint8_t trigger_source = 0;
+
+void setup()
+{
+  my_instrument.SetCommandTreeBase(F("SOURce"));
+    my_instrument.RegisterCommand(F(":VOLTage"), &SetVoltage);
+    my_instrument.RegisterCommand(F(":VOLTage?"), &GetVoltage);
+  my_instrument.SetCommandTreeBase(F("OUTPut"));
+    my_instrument.RegisterCommand(F(":STATe"), &SetOutput);
+  my_instrument.SetCommandTreeBase(F("TRIGger"));
+    my_instrument.RegisterCommand(F(":COUNt"), &SetTriggerCount);
+    my_instrument.RegisterCommand(F(":SOURce"), &SetTriggerSource);
+  my_instrument.SetCommandTreeBase(F(""));
+  my_instrument.RegisterCommand(F("SYSTem:ERRor?"), &GetLastError);
+
+  Serial.begin(9600);
+}
+
+void loop()
+{
+  my_instrument.ProcessInput(Serial, "\n");
+}
+
+void SetVoltage(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  //The value is only changed if the parameter is valid
+  //DEFault sets the value passed to GetReal (set it before calling)
+  float new_voltage = 1.0;
+  if (my_instrument.GetReal(parameters, 0, new_voltage, 0.0, 5.0, "V",
+                            interface))
+    voltage = new_voltage;
+}
+
+void GetVoltage(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  interface.println(voltage, 3);
+}
+
+void SetOutput(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  my_instrument.GetBoolean(parameters, 0, output_enabled, interface);
+}
+
+void SetTriggerCount(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  //Integer parameters use integer arithmetic only (decimals are rounded)
+  long count = 1;
+  if (my_instrument.GetInteger(parameters, 0, count, 1, 1000, interface))
+    trigger_count = count;
+}
+
+void SetTriggerSource(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  //trigger_source will be 0 for BUS, 1 for IMMediate and 2 for EXTernal
+  my_instrument.GetChoice(parameters, 0, "BUS|IMMediate|EXTernal",
+                          trigger_source, interface);
+}
+
+void GetLastError(SCPI_C commands, SCPI_P parameters, Stream& interface) {
+  switch(my_instrument.last_error){
+    case my_instrument.ErrorCode::MissingParameter:
+      interface.println(F("Missing parameter"));
+      break;
+    case my_instrument.ErrorCode::InvalidParameter:
+      interface.println(F("Invalid parameter"));
+      break;
+    case my_instrument.ErrorCode::OutOfRange:
+      interface.println(F("Parameter out of range"));
+      break;
+    case my_instrument.ErrorCode::NoError:
+      interface.println(F("No Error"));
+      break;
+    default:
+      interface.println(F("Communication error"));
+      break;
+  }
+  my_instrument.last_error = my_instrument.ErrorCode::NoError;
+}
@@ -0,0 +1,1082 @@
+/*
+Vrekrer_scpi_parser library.
+Host benchmark suite.
+
+Measures the parser hot paths (SCPI_Parser::Execute, SCPI_Parser::GetMessage
+and the keyword matching in SCPI_Parser::GetCommandCode_) on a Linux host,
+using the Arduino stand-in found in extras/host.
+
+Reported values (best of several runs):
+  cmds/s      : Executed commands (message units) per second.
+  ns/dispatch : Nanoseconds per executed command.
+  ns/byte     : Nanoseconds per message byte.
+
+Suites:
+  ieee    : SCPI required and IEEE 488.2 mandated commands
+            (see the Configuration_Options example), also with the
+            default 8 bits hash_t (hash8 cases).
+  table   : The ieee commands from a compile time command table.
+  tokens  : Scaling with the number of registered tokens.
+  depth   : Scaling with the command tree depth.
+  length  : Scaling with the message length.
+  lexer   : Message splitting (parameters, message units and quoted strings).
+  decode  : Parameter decoding (ns/dispatch is ns per parameter), compared
+            with String::toInt/toFloat and strtol/strtod.
+  register: Command registration time (ns/dispatch is ns per command).
+  pipeline: Many messages received at once (ProcessInput once per message,
+            ProcessAllInput once for all of them and Feed with all of them
+            or in 64 byte chunks).
+  response: Queries printing 16 values each (the case shows the number of
+            writes to the interface per message).
+  block   : Arbitrary block upload, read by the handler in 64 byte chunks.
+  threads : Concurrent execution with a frozen parser, from 1 thread up to
+            the number of cores (cmds/s is the total of all the threads).
+  polling : A few queries repeated over a large command tree, the case
+            shows the header cache size (see scpi_benchmark_cache).
+  handlers: Handlers with the by value signature compared with context
+            handlers (by reference), for commands with several parameters.
+  suffixes: Channel routing in a SOURce#:CHANnel# tree, with the suffixes
+            converted by the parser (SCPI_Commands::Suffix) or by the
+            handler (from the keywords' text).
+  errors  : Bursts of unknown commands stored in the error queue, read 
+            back with SYSTem:ERRor? or discarded while the queue is full.
+  streams : A 4000 bytes block query, printed by the handler or streamed
+            (StreamResponse) to an interface that accepts 64 bytes per
+            call, the case shows the calls needed (ns/byte is per 
+            response byte).
+  optional: [SOURce]:VOLTage[:LEVel][:IMMediate][:AMPLitude] registered as
+            its 16 forms or once with optional nodes, for the shortest 
+            (VOLT) and the longest (SOUR:VOLT:LEV:IMM:AMPL) headers.
+
+Each case runs one checked round first, the benchmark exits if the called
+handlers are not the expected ones or if the error handler was called.
+
+Usage:
+  scpi_benchmark [--quick] [suite ...]
+*/
+
+//Large enough limits for all the sweeps
+#define SCPI_ARRAY_SYZE 10
+#define SCPI_MAX_TOKENS 250
+#define SCPI_MAX_COMMANDS 250
+#define SCPI_BUFFER_LENGTH 1100
+#define SCPI_HASH_TYPE uint32_t
+#define SCPI_CONST_TABLE 1
+#ifndef SCPI_BLOCK_DATA
+  #define SCPI_BLOCK_DATA 1
+#endif
+#ifndef SCPI_RECEIVE_BUFFER_LENGTH
+  #define SCPI_RECEIVE_BUFFER_LENGTH 256
+#endif
+#ifndef SCPI_RESPONSE_BUFFER_LENGTH
+  #define SCPI_RESPONSE_BUFFER_LENGTH 128
+#endif
+#ifndef SCPI_HANDLER_CONTEXT
+  #define SCPI_HANDLER_CONTEXT 1
+#endif
+#ifndef SCPI_ERROR_QUEUE_LENGTH
+  #define SCPI_ERROR_QUEUE_LENGTH 16
+  #define SCPI_ERROR_CONTEXT_LENGTH 16
+#endif
+#ifndef SCPI_MAX_STREAMS
+  #define SCPI_MAX_STREAMS 1
+#endif
+#ifndef SCPI_OPTIONAL_NODES
+  #define SCPI_OPTIONAL_NODES 1
+#endif
+
+#include "Arduino.h"
+#include "MemoryStream.h"
+#include "Vrekrer_scpi_parser.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+//Error handler calls, from any thread.
+std::atomic<unsigned long> error_calls(0);
+double target_seconds = 0.25;
+const int kRepeats = 5;
+
+//Handlers that ran in the checked round (see CheckCalls), NULL otherwise.
+//One per thread, the threads suite checks a round in each thread.
+thread_local std::vector<int>* call_log = NULL;
+
+//Logs the id of a handler call in the checked round.
+void LogCall(int id) {
+  if (call_log != NULL) call_log->push_back(id);
+}
+
+//Handler number N, each registered command gets its own (see Handler).
+template <int N>
+void CallHandler(SCPI_C, SCPI_P, Stream&) {
+  LogCall(N);
+}
+
+const int kHandlers = 256;
+SCPI_caller_t handlers[kHandlers];
+
+//Fills handlers with CallHandler<0> to CallHandler<N - 1>.
+template <int N>
+struct HandlerTable {
+  static void Fill() {
+    HandlerTable<N - 1>::Fill();
+    handlers[N - 1] = &CallHandler<N - 1>;
+  }
+};
+
+template <>
+struct HandlerTable<0> {
+  static void Fill() {}
+};
+
+//Handler number id (0 to kHandlers - 1).
+SCPI_caller_t Handler(int id) {
+  return handlers[id];
+}
+
+void CountError(SCPI_C, SCPI_P, Stream&) {
+  ++error_calls;
+}
+
+//A set of program messages sent to a parser.
+struct Workload {
+  std::vector<std::string> messages;
+  //Handler ids of the message units, in execution order (see LogCall).
+  std::vector<int> handlers;
+  //Number of message units (';' separated commands) in messages.
+  unsigned long commands = 0;
+  //Total length of the messages, without termination chars.
+  unsigned long bytes = 0;
+
+  //Add a message, unit_handlers are the handlers of its message units.
+  void Add(const std::string& message, std::vector<int> unit_handlers) {
+    messages.push_back(message);
+    handlers.insert(handlers.end(), unit_handlers.begin(), 
+                    unit_handlers.end());
+    commands += 1 + std::count(message.begin(), message.end(), ';');
+    bytes += message.size();
+  }
+};
+
+//Runs body() repeatedly and returns the best time per call, in nanoseconds.
+template <class Body>
+double BestNanoseconds(Body body) {
+  using clock = std::chrono::steady_clock;
+  //Calibrate the number of calls per run
+  unsigned long calls = 1;
+  while (true) {
+    clock::time_point start = clock::now();
+    for (unsigned long i = 0; i < calls; i++) body();
+    double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    if (elapsed > target_seconds / kRepeats / 4) {
+      calls = std::max(1.0, calls * (target_seconds / kRepeats) / elapsed);
+      break;
+    }
+    calls *= 2;
+  }
+  double best = 1e300;
+  for (int r = 0; r < kRepeats; r++) {
+    clock::time_point start = clock::now();
+    for (unsigned long i = 0; i < calls; i++) body();
+    double elapsed = std::chrono::duration<double, std::nano>(
+                       clock::now() - start).count();
+    best = std::min(best, elapsed / calls);
+  }
+  return best;
+}
+
+void PrintHeader() {
+  printf("Vrekrer SCPI parser %s benchmark (hash: %u bits)\n\n",
+         VREKRER_SCPI_VERSION, (unsigned)(sizeof(scpi_hash_t) * 8));
+  printf("%-8s %-22s %-16s %12s %12s %10s\n",
+         "suite", "case", "path", "cmds/s", "ns/dispatch", "ns/byte");
+}
+
+void Report(const char* suite, const std::string& name, const char* path,
+            const Workload& workload, double ns_per_round) {
+  double ns_per_command = ns_per_round / workload.commands;
+  printf("%-8s %-22s %-16s %12.0f %12.1f %10.2f\n",
+         suite, name.c_str(), path, 1e9 / ns_per_command, ns_per_command,
+         ns_per_round / workload.bytes);
+  fflush(stdout);
+}
+
+//Handler ids as text, e.g. "4,3,5".
+std::string HandlersText(const std::vector<int>& ids) {
+  std::string text;
+  for (int id : ids) text += (text.empty() ? "" : ",") + std::to_string(id);
+  return text;
+}
+
+/*
+ Runs one round of a case, logging the handlers. Exits if they are not the
+ expected ones (in the same order) or if the error handler was called.
+*/
+template <class Body>
+void CheckCalls(const char* suite, const std::string& name,
+                const std::vector<int>& expected, Body body) {
+  std::vector<int> log;
+  error_calls = 0;
+  call_log = &log;
+  body();
+  call_log = NULL;
+  if ((log != expected) or (error_calls != 0)) {
+    fprintf(stderr, "%s/%s: expected handlers %s, got %s (%lu errors)\n",
+            suite, name.c_str(), HandlersText(expected).c_str(), 
+            HandlersText(log).c_str(), error_calls.load());
+    exit(1);
+  }
+}
+
+/*
+ Measures a workload through SCPI_Parser::Execute (dispatch only) and
+ through SCPI_Parser::ProcessInput (reception and dispatch).
+*/
+template <class Parser>
+void Measure(const char* suite, const std::string& name,
+             Parser& parser, const Workload& workload) {
+  MemoryStream sink;
+  char message[SCPI_BUFFER_LENGTH + 1];
+
+  auto execute_round = [&]() {
+    for (const std::string& m : workload.messages) {
+      memcpy(message, m.c_str(), m.size() + 1);
+      parser.Execute(message, sink);
+    }
+  };
+  CheckCalls(suite, name, workload.handlers, execute_round);
+  Report(suite, name, "Execute", workload, BestNanoseconds(execute_round));
+
+  std::string input;
+  for (const std::string& m : workload.messages) input += m + "\n";
+  MemoryStream stream;
+  stream.SetInput(input.data(), input.size());
+  auto process_round = [&]() {
+    stream.Rewind();
+    for (size_t i = 0; i < workload.messages.size(); i++)
+      parser.ProcessInput(stream, "\n");
+  };
+  CheckCalls(suite, name, workload.handlers, process_round);
+  Report(suite, name, "ProcessInput", workload, BestNanoseconds(process_round));
+}
+
+template <class Parser = SCPI_Parser>
+std::unique_ptr<Parser> NewParser() {
+  std::unique_ptr<Parser> parser(new Parser());
+  parser->SetErrorHandler(&CountError);
+  return parser;
+}
+
+//Generated token, e.g. "BCDAxyz" (short form "BCDA").
+std::string TokenName(int index) {
+  std::string name = "AAAA";
+  for (int i = 3; i >= 0; i--) {
+    name[i] = 'A' + index % 26;
+    index /= 26;
+  }
+  return name + "xyz";
+}
+
+//Short or long form, in lower or upper case, of a generated token.
+std::string Keyword(int index, int variant) {
+  std::string keyword = TokenName(index);
+  if (variant & 1) keyword.resize(4);
+  if (variant & 2) for (char& c : keyword) c = tolower(c);
+  return keyword;
+}
+
+// ## Suites ##
+
+//Handler ids of the ieee commands: the SCPI required commands are 0 to 11
+//(in registration order) and the IEEE 488.2 ones are 12 to 24.
+template <class Parser>
+void RegisterIeee(Parser& parser) {
+  parser.SetCommandTreeBase("STATus:OPERation");
+    parser.RegisterCommand(":CONDition?", Handler(0));
+    parser.RegisterCommand(":ENABle", Handler(1));
+    parser.RegisterCommand(":EVENt?", Handler(2));
+  parser.SetCommandTreeBase("STATus:QUEStionable");
+    parser.RegisterCommand(":CONDition?", Handler(3));
+    parser.RegisterCommand(":ENABle", Handler(4));
+    parser.RegisterCommand(":EVENt?", Handler(5));
+  parser.SetCommandTreeBase("STATus");
+    parser.RegisterCommand(":OPERation?", Handler(6));
+    parser.RegisterCommand(":QUEStionable?", Handler(7));
+    parser.RegisterCommand(":PRESet", Handler(8));
+  parser.SetCommandTreeBase("SYSTem");
+    parser.RegisterCommand(":ERRor?", Handler(9));
+    parser.RegisterCommand(":ERRor:NEXT?", Handler(10));
+    parser.RegisterCommand(":VERSion?", Handler(11));
+  parser.SetCommandTreeBase("");
+  const char* common[] = {"*CLS", "*ESE", "*ESE?", "*ESR?", "*IDN?", "*OPC",
+                          "*OPC?", "*RST", "*SRE", "*SRE?", "*STB?", "*TST?",
+                          "*WAI"};
+  for (int i = 0; i < 13; i++) 
+    parser.RegisterCommand(common[i], Handler(12 + i));
+}
+
+//Measures the ieee cases (the ieee commands must be registered).
+template <class Parser>
+void MeasureIeee(const char* suite, const std::string& label, 
+                 Parser& parser, bool compound) {
+  Workload workload;
+  workload.Add("*IDN?", {16});
+  workload.Add("*RST;*CLS", {19, 12});
+  workload.Add("STATus:OPERation:CONDition?", {0});
+  workload.Add("stat:ques:enab 512", {4});
+  workload.Add("SYST:ERR:NEXT?", {10});
+  workload.Add("SYSTem:VERSion?", {11});
+  workload.Add("STAT:PRES", {8});
+  workload.Add("*ESE 32;*SRE 16;*OPC?", {13, 20, 18});
+  Measure(suite, "mixed" + label, parser, workload);
+
+  Workload single;
+  single.Add("*IDN?", {16});
+  Measure(suite, "*IDN?" + label, parser, single);
+
+  Workload deep;
+  deep.Add("STATus:QUEStionable:CONDition?", {3});
+  Measure(suite, "STAT:QUES:COND?" + label, parser, deep);
+  if (not compound) return;
+
+  //The same message units, with full headers and relative to the path
+  Workload full;
+  full.Add("STAT:QUES:ENAB 512;STAT:QUES:COND?;STAT:QUES:EVEN?", {4, 3, 5});
+  Measure(suite, "full headers" + label, parser, full);
+
+  Workload relative;
+  relative.Add("STAT:QUES:ENAB 512;COND?;EVEN?", {4, 3, 5});
+  Measure(suite, "compound headers" + label, parser, relative);
+}
+
+//Configuration with the default hash size (more likely hash crashes).
+struct Hash8_Config : SCPI_Parser_Config {
+  using hash_type = uint8_t;
+};
+
+void IeeeSuite() {
+  std::unique_ptr<SCPI_Parser> parser = NewParser();
+  RegisterIeee(*parser);
+  MeasureIeee("ieee", "", *parser, true);
+  //Checks the dispatch with the default 8 bits hashes too
+  std::unique_ptr<SCPI_Basic_Parser<Hash8_Config>> parser8 = 
+    NewParser<SCPI_Basic_Parser<Hash8_Config>>();
+  RegisterIeee(*parser8);
+  MeasureIeee("ieee", ", hash8", *parser8, false);
+}
+
+const char ieee_tokens[] PROGMEM =
+  "STATus:OPERation:CONDition:ENABle:EVENt:QUEStionable:PRESet:SYSTem:ERRor:"
+  "NEXT:VERSion:*CLS:*ESE:*ESR:*IDN:*OPC:*RST:*SRE:*STB:*TST:*WAI";
+
+//Same handler ids as RegisterIeee.
+constexpr SCPI_Const_Command ieee_commands[] = {
+  {"STATus:OPERation:CONDition?", &CallHandler<0>},
+  {"STATus:OPERation:ENABle", &CallHandler<1>},
+  {"STATus:OPERation:EVENt?", &CallHandler<2>},
+  {"STATus:QUEStionable:CONDition?", &CallHandler<3>},
+  {"STATus:QUEStionable:ENABle", &CallHandler<4>},
+  {"STATus:QUEStionable:EVENt?", &CallHandler<5>},
+  {"STATus:OPERation?", &CallHandler<6>},
+  {"STATus:QUEStionable?", &CallHandler<7>},
+  {"STATus:PRESet", &CallHandler<8>},
+  {"SYSTem:ERRor?", &CallHandler<9>},
+  {"SYSTem:ERRor:NEXT?", &CallHandler<10>},
+  {"SYSTem:VERSion?", &CallHandler<11>},
+  {"*CLS", &CallHandler<12>}, {"*ESE", &CallHandler<13>}, 
+  {"*ESE?", &CallHandler<14>}, {"*ESR?", &CallHandler<15>}, 
+  {"*IDN?", &CallHandler<16>}, {"*OPC", &CallHandler<17>},
+  {"*OPC?", &CallHandler<18>}, {"*RST", &CallHandler<19>}, 
+  {"*SRE", &CallHandler<20>}, {"*SRE?", &CallHandler<21>}, 
+  {"*STB?", &CallHandler<22>}, {"*TST?", &CallHandler<23>},
+  {"*WAI", &CallHandler<24>},
+};
+
+constexpr auto ieee_table PROGMEM = SCPI_MakeConstTable(ieee_tokens,
+                                                        ieee_commands);
+
+void TableSuite() {
+  std::unique_ptr<SCPI_Parser> parser = NewParser();
+  parser->SetCommandTable(ieee_table);
+  MeasureIeee("table", "", *parser, false);
+}
+
+void TokensSuite() {
+  for (int tokens : {8, 16, 32, 64, 128, 240}) {
+    std::unique_ptr<SCPI_Parser> parser = NewParser();
+    Workload workload;
+    for (int i = 0; i < tokens; i++) {
+      parser->RegisterCommand((TokenName(i) + "?").c_str(), Handler(i));
+      workload.Add(Keyword(i, i) + "?", {i});
+    }
+    Measure("tokens", std::to_string(tokens) + " tokens", *parser, workload);
+  }
+}
+
+void DepthSuite() {
+  const int pool = 24;
+  const int commands = 16;
+  for (int depth = 1; depth <= 8; depth++) {
+    std::unique_ptr<SCPI_Parser> parser = NewParser();
+    Workload workload;
+    for (int c = 0; c < commands; c++) {
+      std::string command, message;
+      for (int i = 0; i < depth; i++) {
+        int token = (c + 5 * i) % pool;
+        command += (i ? ":" : "") + TokenName(token);
+        message += (i ? ":" : "") + Keyword(token, c + i);
+      }
+      parser->RegisterCommand(command.c_str(), Handler(c));
+      workload.Add(message, {c});
+    }
+    Measure("depth", "depth " + std::to_string(depth), *parser, workload);
+  }
+}
+
+void LengthSuite() {
+  std::unique_ptr<SCPI_Parser> parser = NewParser();
+  parser->RegisterCommand("CONFigure:DATA", Handler(0));
+  for (int length : {16, 64, 256, 1024}) {
+    std::string message = "CONF:DATA ";
+    while (message.size() + 8 <= (size_t)length) message += "1.23456,";
+    message += std::string(length - message.size(), '9');
+    Workload workload;
+    workload.Add(message, {0});
+    Measure("length", std::to_string(length) + " bytes", *parser, workload);
+  }
+}
+
+void LexerSuite() {
+  std::unique_ptr<SCPI_Parser> parser = NewParser();
+  parser->RegisterCommand("CONFigure:DATA", Handler(0));
+  parser->RegisterCommand("*CLS", Handler(1));
+  std::vector<std::pair<std::string, std::string>> cases = {
+    {"32 parameters", "CONF:DATA 1.5"},
+    {"32 units", "*CLS"},
+    {"quoted strings", "CONF:DATA 'a, b, c'"},
+  };
+  for (int i = 0; i < 31; i++) {
+    cases[0].second += ", " + std::to_string(i) + ".5";
+    cases[1].second += ";*CLS";
+    cases[2].second += ", \"x, y, " + std::to_string(i) + "\"";
+  }
+  for (const auto& lexer_case : cases) {
+    Workload workload;
+    //32 *CLS units (handler 1) or a CONF:DATA unit (handler 0)
+    bool units = (lexer_case.second[0] == '*');
+    workload.Add(lexer_case.second, std::vector<int>(units ? 32 : 1, units));
+    Measure("lexer", lexer_case.first, *parser, workload);
+  }
+}
+
+void DecodeSuite() {
+  std::unique_ptr<SCPI_Parser> parser = NewParser();
+  MemoryStream sink;
+  struct DecodeCase {
+    const char* name;
+    const char* text;
+    bool integer;
+  };
+  const DecodeCase cases[] = {
+    {"NR1 12345", "12345", true},
+    {"NR2 -1.2345", "-1.2345", false},
+    {"NR3 1.5E-3", "1.5E-3", false},
+    {"suffix 150 mV", "150 mV", false},
+    {"suffix 1.5 kV", "1.5 kV", false},
+  };
+  volatile long long_sink = 0;
+  volatile float float_sink = 0;
+  for (const DecodeCase& decode_case : cases) {
+    char text[16];
+    strcpy(text, decode_case.text);
+    SCPI_Parameters parameters;
+    parameters.Append(text);
+    Workload workload;
+    workload.Add(text, {});
+    if (decode_case.integer) {
+      auto decode = [&]() {
+        long value = 0;
+        parser->GetInteger(parameters, 0, value, 0, 100000, sink);
+        long_sink = value;
+      };
+      CheckCalls("decode", decode_case.name, {}, decode);
+      Report("decode", decode_case.name, "GetInteger", workload,
+             BestNanoseconds(decode));
+      Report("decode", decode_case.name, "String.toInt", workload,
+             BestNanoseconds([&]() {
+               long_sink = String(parameters[0]).toInt();
+             }));
+      Report("decode", decode_case.name, "strtol", workload,
+             BestNanoseconds([&]() {
+               long_sink = strtol(parameters[0], NULL, 10);
+             }));
+    } else {
+      auto decode = [&]() {
+        float value = 0;
+        parser->GetReal(parameters, 0, value, -1e4, 1e4, "V", sink);
+        float_sink = value;
+      };
+      CheckCalls("decode", decode_case.name, {}, decode);
+      Report("decode", decode_case.name, "GetReal", workload,
+             BestNanoseconds(decode));
+      Report("decode", decode_case.name, "String.toFloat", workload,
+             BestNanoseconds([&]() {
+               float_sink = String(parameters[0]).toFloat();
+             }));
+      Report("decode", decode_case.name, "strtod", workload,
+             BestNanoseconds([&]() {
+               float_sink = strtod(parameters[0], NULL);
+             }));
+    }
+  }
+}
+
+void RegisterSuite() {
+  for (int size : {32, 128, 240}) {
+    std::vector<std::string> names;
+    std::vector<SCPI_Const_Command> table;
+    Workload workload;
+    for (int i = 0; i < size; i++) {
+      names.push_back(TokenName(i % 60) + ":" + TokenName(60 + i / 60) + "?");
+      workload.Add(names.back(), {i});
+    }
+    for (const std::string& name : names)
+      table.push_back({name.c_str(), Handler(0)});
+    std::string label = std::to_string(size) + " commands";
+
+    auto register_each = [&]() {
+      std::unique_ptr<SCPI_Parser> parser(new SCPI_Parser());
+      for (const std::string& name : names)
+        parser->RegisterCommand(name.c_str(), Handler(0));
+    };
+    Report("register", label, "RegisterCommand", workload,
+           BestNanoseconds(register_each));
+    auto register_all = [&]() {
+      std::unique_ptr<SCPI_Parser> parser(new SCPI_Parser());
+      parser->RegisterCommands(table.data(), table.size());
+    };
+    Report("register", label, "RegisterCommands", workload,
+           BestNanoseconds(register_all));
+  }
+}
+
+void PipelineSuite() {
+  std::unique_ptr<SCPI_Parser> parser = NewParser();
+  parser->RegisterCommand("SOURce:VOLTage", Handler(0));
+  for (int count : {10, 200}) {
+    Workload workload;
+    std::string input;
+    for (int i = 0; i < count; i++) {
+      workload.Add("SOUR:VOLT " + std::to_string(i) + ".125", {0});
+      input += workload.messages.back() + "\n";
+    }
+    MemoryStream stream;
+    stream.SetInput(input.data(), input.size());
+    std::string label = std::to_string(count) + " messages";
+
+    auto process_each = [&]() {
+      stream.Rewind();
+      for (int i = 0; i < count; i++) parser->ProcessInput(stream, "\n");
+    };
+    CheckCalls("pipeline", label, workload.handlers, process_each);
+    Report("pipeline", label, "ProcessInput", workload,
+           BestNanoseconds(process_each));
+
+    auto process_all = [&]() {
+      stream.Rewind();
+      parser->ProcessAllInput(stream, "\n");
+    };
+    CheckCalls("pipeline", label, workload.handlers, process_all);
+    Report("pipeline", label, "ProcessAllInput", workload,
+           BestNanoseconds(process_all));
+
+    auto feed_all = [&]() {
+      parser->Feed(input.data(), input.size(), stream, "\n");
+    };
+    CheckCalls("pipeline", label, workload.handlers, feed_all);
+    Report("pipeline", label, "Feed", workload, BestNanoseconds(feed_all));
+
+    auto feed_chunks = [&]() {
+      for (size_t i = 0; i < input.size(); i += 64)
+        parser->Feed(input.data() + i, std::min<size_t>(64, input.size() - i),
+                     stream, "\n");
+    };
+    CheckCalls("pipeline", label, workload.handlers, feed_chunks);
+    Report("pipeline", label, "Feed 64 bytes", workload, 
+           BestNanoseconds(feed_chunks));
+  }
+}
+
+//Prints 16 values, one print call per value and separator.
+void PrintValues(SCPI_C, SCPI_P, Stream& interface) {
+  for (int i = 0; i < 16; i++) {
+    if (i > 0) interface.print(',');
+    interface.print(i * 64 + 1);
+  }
+  interface.print('\n');
+  LogCall(0);
+}
+
+void ResponseSuite() {
+  std::unique_ptr<SCPI_Parser> parser = NewParser();
+  parser->RegisterCommand("MEASure:ALL?", &PrintValues);
+  for (int count : {1, 4}) {
+    Workload workload;
+    std::string message = "MEAS:ALL?";
+    for (int i = 1; i < count; i++) message += ";MEAS:ALL?";
+    workload.Add(message, std::vector<int>(count, 0));
+    MemoryStream sink;
+    char buffer[SCPI_BUFFER_LENGTH + 1];
+    auto execute = [&]() {
+      memcpy(buffer, message.c_str(), message.size() + 1);
+      parser->Execute(buffer, sink);
+    };
+    CheckCalls("response", std::to_string(count) + " queries", 
+               workload.handlers, execute);
+    std::string label = std::to_string(count) + " queries, " 
+                        + std::to_string(sink.write_calls) + " writes";
+    Report("response", label, "Execute", workload, BestNanoseconds(execute));
+  }
+}
+
+#if SCPI_BLOCK_DATA
+//Reads the block, logging the number of bytes read as its id.
+void ReadBlock(SCPI_C, SCPI_P, Stream& interface) {
+  char chunk[64];
+  int length = 0;
+  while (interface.available() > 0) 
+    length += interface.readBytes(chunk, sizeof(chunk));
+  LogCall(length);
+}
+
+void BlockSuite() {
+  std::unique_ptr<SCPI_Parser> parser = NewParser();
+  parser->RegisterCommand("DATA:UPLoad", &ReadBlock);
+  for (int length : {256, 1024, 16384}) {
+    std::string length_digits = std::to_string(length);
+    Workload workload;
+    workload.Add("DATA:UPL #" + std::to_string(length_digits.size())
+                 + length_digits + std::string(length, 'x'), {length});
+    std::string input = workload.messages.back() + "\n";
+    MemoryStream stream;
+    stream.SetInput(input.data(), input.size());
+    std::string label = std::to_string(length) + " bytes";
+
+    auto process_block = [&]() {
+      stream.Rewind();
+      parser->ProcessInput(stream, "\n");
+    };
+    CheckCalls("block", label, workload.handlers, process_block);
+    Report("block", label, "ProcessInput", workload,
+           BestNanoseconds(process_block));
+  }
+}
+#endif
+
+/*
+ Runs body(rounds) in several threads at the same time, returns the best
+ wall time per round of one thread, in nanoseconds.
+*/
+template <class Body>
+double BestThreadedNanoseconds(unsigned threads, unsigned long rounds,
+                               Body body) {
+  using clock = std::chrono::steady_clock;
+  double best = 1e300;
+  for (int r = 0; r < kRepeats; r++) {
+    std::vector<std::thread> workers;
+    clock::time_point start = clock::now();
+    for (unsigned t = 0; t < threads; t++)
+      workers.emplace_back(body, rounds);
+    for (std::thread& worker : workers) worker.join();
+    double elapsed = std::chrono::duration<double, std::nano>(
+                       clock::now() - start).count();
+    best = std::min(best, elapsed / rounds);
+  }
+  return best;
+}
+
+void ThreadsSuite() {
+  std::unique_ptr<SCPI_Parser> parser = NewParser();
+  parser->SetCommandTreeBase("STATus:OPERation");
+    parser->RegisterCommand(":CONDition?", Handler(0));
+    parser->RegisterCommand(":ENABle", Handler(1));
+  parser->SetCommandTreeBase("SOURce");
+    parser->RegisterCommand(":VOLTage", Handler(2));
+    parser->RegisterCommand(":VOLTage?", Handler(3));
+  parser->SetCommandTreeBase("");
+  parser->RegisterCommand("*IDN?", Handler(4));
+  parser->RegisterCommand("SYSTem:ERRor?", Handler(5));
+  parser->Freeze();
+
+  //No message raises errors: last_error, the error queue and the error
+  //handler calls are shared by the threads (see SCPI_Parser::Freeze).
+  Workload workload;
+  workload.Add("*IDN?", {4});
+  workload.Add("SOUR:VOLT 2.5;:SOUR:VOLT?", {2, 3});
+  workload.Add("stat:oper:enab 16;STATus:OPERation:CONDition?", {1, 0});
+  workload.Add("SYST:ERR?", {5});
+  std::string input;
+  for (const std::string& m : workload.messages) input += m + "\n";
+
+  //Threads whose first round did not call the expected handlers
+  std::atomic<unsigned> wrong_threads(0);
+  //Each thread uses its own message buffer, session, streams and call log
+  auto execute = [&](unsigned long rounds) {
+    MemoryStream sink;
+    char message[SCPI_BUFFER_LENGTH + 1];
+    std::vector<int> log;
+    for (unsigned long i = 0; i < rounds; i++) {
+      call_log = (i == 0) ? &log : NULL;
+      for (const std::string& m : workload.messages) {
+        memcpy(message, m.c_str(), m.size() + 1);
+        parser->Execute(message, sink);
+      }
+    }
+    call_log = NULL;
+    if (log != workload.handlers) ++wrong_threads;
+  };
+  auto process = [&](unsigned long rounds) {
+    SCPI_Session session;
+    MemoryStream stream;
+    stream.SetInput(input.data(), input.size());
+    std::vector<int> log;
+    for (unsigned long i = 0; i < rounds; i++) {
+      call_log = (i == 0) ? &log : NULL;
+      stream.Rewind();
+      parser->ProcessAllInput(session, stream, "\n");
+    }
+    call_log = NULL;
+    if (log != workload.handlers) ++wrong_threads;
+  };
+
+  unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+  //Rounds per thread, from the single thread time
+  unsigned long rounds = std::max(1.0, target_seconds / kRepeats * 1e9
+                                       / BestNanoseconds([&]() { 
+                                           execute(1); 
+                                         }));
+  for (unsigned threads = 1; threads <= cores; 
+       threads = (threads < cores) ? std::min(threads * 2, cores) 
+                                   : cores + 1) {
+    std::string label = std::to_string(threads) 
+                        + ((threads == 1) ? " thread" : " threads");
+    error_calls = 0;
+    wrong_threads = 0;
+    double execute_ns = BestThreadedNanoseconds(threads, rounds, execute);
+    double process_ns = BestThreadedNanoseconds(threads, rounds, process);
+    if ((wrong_threads != 0) or (error_calls != 0)) {
+      fprintf(stderr, "threads/%s: %u threads with wrong handlers "
+              "(%lu errors)\n", label.c_str(), wrong_threads.load(), 
+              error_calls.load());
+      exit(1);
+    }
+    //Time per round of all the threads
+    Report("threads", label, "Execute", workload, execute_ns / threads);
+    Report("threads", label, "ProcessAllInput", workload, 
+           process_ns / threads);
+  }
+}
+
+void PollingSuite() {
+  std::unique_ptr<SCPI_Parser> parser = NewParser();
+  //An instrument with numbered channels and some generated subsystems
+  parser->SetCommandTreeBase("SOURce#");
+    parser->RegisterCommand(":VOLTage", Handler(0));
+    parser->RegisterCommand(":VOLTage?", Handler(1));
+    parser->RegisterCommand(":CURRent", Handler(2));
+    parser->RegisterCommand(":CURRent?", Handler(3));
+  parser->SetCommandTreeBase("MEASure");
+    parser->RegisterCommand(":VOLTage?", Handler(4));
+    parser->RegisterCommand(":CURRent?", Handler(5));
+  parser->SetCommandTreeBase("");
+  parser->RegisterCommand("STATus:OPERation:CONDition?", Handler(6));
+  for (int i = 0; i < 96; i++)
+    parser->RegisterCommand((TokenName(i) + ":" + TokenName(i + 96) 
+                             + "?").c_str(), Handler(7 + i));
+
+  Workload workload;
+  workload.Add("MEAS:VOLT?", {4});
+  workload.Add("SOUR1:CURR 0.5", {2});
+  workload.Add("MEAS:CURR?", {5});
+  workload.Add("STAT:OPER:COND?", {6});
+  workload.Add("MEAS:VOLT?;MEAS:CURR?", {4, 5});
+  #if SCPI_HEADER_CACHE
+  std::string label = "cache " + std::to_string(SCPI_HEADER_CACHE);
+  #else
+  std::string label = "no cache";
+  #endif
+  Measure("polling", label, *parser, workload);
+  #if SCPI_HEADER_CACHE
+  printf("%-8s %-22s hits: %lu, misses: %lu\n", "polling", label.c_str(), 
+         (unsigned long)parser->header_cache_hits, 
+         (unsigned long)parser->header_cache_misses);
+  #endif
+}
+
+#if SCPI_HANDLER_CONTEXT
+//Logs the handler id pointed by the context.
+void ContextCall(const SCPI_Commands&, const SCPI_Parameters&, Stream&,
+                 void* context) {
+  LogCall(*static_cast<int*>(context));
+}
+
+void HandlersSuite() {
+  std::unique_ptr<SCPI_Parser> parser = NewParser();
+  static int context_id = 1;
+  parser->RegisterCommand("DATA:LEGacy", Handler(0));
+  parser->RegisterCommand("DATA:CONText", &ContextCall, &context_id);
+  for (int count : {1, 8}) {
+    std::string values = "1";
+    for (int i = 1; i < count; i++) values += "," + std::to_string(i + 1);
+    std::string label = std::to_string(count) + " parameters, ";
+    Workload legacy;
+    legacy.Add("DATA:LEG " + values, {0});
+    Measure("handlers", label + "by value", *parser, legacy);
+    Workload context;
+    context.Add("DATA:CONT " + values, {1});
+    Measure("handlers", label + "context", *parser, context);
+  }
+}
+#endif
+
+//Voltages of a 32 x 32 channels instrument, set by the suffixes suite.
+//The handlers log source * 32 + channel as their id.
+float channel_voltages[32][32];
+
+void RouteBySuffix(SCPI_C commands, SCPI_P parameters, Stream&) {
+  uint16_t source = commands.Suffix(0);
+  uint16_t channel = commands.Suffix(1);
+  if ((source < 32) and (channel < 32)) 
+    channel_voltages[source][channel] = atof(parameters.First());
+  LogCall(source * 32 + channel);
+}
+
+//Suffix of a keyword, converted from its text (1 if omitted).
+long KeywordSuffix(const char* keyword) {
+  const char* digits = keyword;
+  while ((digits[0] != '\0') and not isdigit(digits[0])) digits++;
+  return (digits[0] == '\0') ? 1 : strtol(digits, NULL, 10);
+}
+
+void RouteByText(SCPI_C commands, SCPI_P parameters, Stream&) {
+  long source = KeywordSuffix(commands[0]);
+  long channel = KeywordSuffix(commands[1]);
+  if ((source < 32) and (channel < 32)) 
+    channel_voltages[source][channel] = atof(parameters.First());
+  LogCall(source * 32 + channel);
+}
+
+void SuffixesSuite() {
+  for (bool by_suffix : {true, false}) {
+    std::unique_ptr<SCPI_Parser> parser = NewParser();
+    parser->RegisterCommand("SOURce#:CHANnel#:VOLTage", 
+                            by_suffix ? &RouteBySuffix : &RouteByText);
+    Workload workload;
+    for (int i = 0; i < 8; i++) 
+      workload.Add("SOUR" + std::to_string(i * 4) + ":CHAN" 
+                   + std::to_string(31 - i) + ":VOLT 1.5", 
+                   {i * 4 * 32 + 31 - i});
+    Measure("suffixes", by_suffix ? "Suffix()" : "keyword text", *parser, 
+            workload);
+  }
+}
+
+#if SCPI_ERROR_QUEUE_LENGTH
+//Parser of the errors suite, read by its SYSTem:ERRor? procedure.
+SCPI_Parser* errors_parser = NULL;
+
+void PrintError(SCPI_C, SCPI_P, Stream& interface) {
+  errors_parser->PrintNextError(interface);
+}
+
+void ErrorsSuite() {
+  std::unique_ptr<SCPI_Parser> parser = NewParser();
+  errors_parser = parser.get();
+  parser->RegisterCommand("SOURce:VOLTage", Handler(0));
+  parser->RegisterCommand("SYSTem:ERRor?", &PrintError);
+  const int burst = 8;
+  std::string errors = "SOUR:CURR 1";
+  std::string queries = "SYST:ERR?";
+  for (int i = 1; i < burst; i++) {
+    errors += ";SOUR:CURR 1";
+    queries += ";SYST:ERR?";
+  }
+  MemoryStream sink;
+  char buffer[SCPI_BUFFER_LENGTH + 1];
+  auto execute = [&](const std::string& message) {
+    memcpy(buffer, message.c_str(), message.size() + 1);
+    parser->Execute(buffer, sink);
+  };
+  Workload drained;
+  drained.Add(errors, {});
+  drained.Add(queries, {});
+  parser->ClearErrors();
+  Report("errors", "burst of 8, read back", "Execute", drained,
+         BestNanoseconds([&]() {
+           execute(errors);
+           execute(queries);
+         }));
+  if (parser->ErrorCount() != 0) {
+    fprintf(stderr, "errors: %u errors not read\n", parser->ErrorCount());
+    exit(1);
+  }
+  Workload full;
+  full.Add(errors, {});
+  for (int i = 0; i < SCPI_ERROR_QUEUE_LENGTH; i++) execute(errors);
+  Report("errors", "burst of 8, queue full", "Execute", full,
+         BestNanoseconds([&]() { execute(errors); }));
+  parser->ClearErrors();
+}
+#endif
+
+#if SCPI_MAX_STREAMS
+//Response data of the streams suite, and the parser that streams it.
+char trace_data[4000];
+SCPI_Parser* streaming_parser = NULL;
+
+size_t TraceChunk(char* buffer, size_t size, uint32_t position) {
+  memcpy(buffer, trace_data + position, size);
+  return size;
+}
+
+//Writes the whole block at once, as a handler without streams does.
+void PrintTrace(SCPI_C, SCPI_P, Stream& interface) {
+  interface.print("#44000");
+  interface.write((const uint8_t*)trace_data, sizeof(trace_data));
+  interface.print('\n');
+  LogCall(0);
+}
+
+void StreamTrace(SCPI_C, SCPI_P, Stream& interface) {
+  streaming_parser->StreamResponse(interface, &TraceChunk, sizeof(trace_data),
+                                   true);
+  LogCall(1);
+}
+
+void StreamsSuite() {
+  std::unique_ptr<SCPI_Parser> parser = NewParser();
+  streaming_parser = parser.get();
+  parser->RegisterCommand("TRACe:DATA?", &PrintTrace);
+  parser->RegisterCommand("TRACe:STReam?", &StreamTrace);
+  for (const char* message : {"TRAC:DATA?", "TRAC:STR?"}) {
+    Workload workload;
+    workload.Add(message, {(message[5] == 'D') ? 0 : 1});
+    workload.bytes = sizeof(trace_data) + 7;
+    std::string input = std::string(message) + "\n";
+    MemoryStream stream;
+    stream.SetInput(input.data(), input.size());
+    unsigned long calls = 0;
+    auto process = [&]() {
+      stream.Rewind();
+      stream.bytes_written = 0;
+      parser->ProcessInput(stream, "\n");
+      for (calls = 1; not parser->PollResponses(); calls++) {}
+    };
+    std::string kind = (message[5] == 'D') ? "print" : "stream";
+    CheckCalls("streams", kind, workload.handlers, process);
+    std::string label = kind + ", " + std::to_string(calls) + " calls";
+    if (stream.bytes_written != workload.bytes) {
+      fprintf(stderr, "streams/%s: %zu bytes written\n", label.c_str(),
+              stream.bytes_written);
+      exit(1);
+    }
+    Report("streams", label, "ProcessInput", workload,
+           BestNanoseconds(process));
+  }
+}
+#endif
+
+#if SCPI_OPTIONAL_NODES
+void OptionalSuite() {
+  //Every form registered, from VOLTage to SOURce:VOLTage:LEVel:IMMediate:...
+  std::unique_ptr<SCPI_Parser> expanded = NewParser();
+  for (int form = 0; form < 16; form++) {
+    std::string command = (form & 1) ? "SOURce:VOLTage" : "VOLTage";
+    if (form & 2) command += ":LEVel";
+    if (form & 4) command += ":IMMediate";
+    if (form & 8) command += ":AMPLitude";
+    expanded->RegisterCommand(command.c_str(), Handler(form));
+  }
+  std::unique_ptr<SCPI_Parser> optional = NewParser();
+  optional->RegisterCommand("[SOURce]:VOLTage[:LEVel][:IMMediate][:AMPLitude]",
+                            Handler(0));
+  //The shortest form is handler 0 and the longest 15 in expanded
+  Workload shortest;
+  Workload longest;
+  Workload optional_longest;
+  for (int i = 0; i < 10; i++) {
+    shortest.Add("VOLT 1", {0});
+    longest.Add("SOUR:VOLT:LEV:IMM:AMPL 1", {15});
+    optional_longest.Add("SOUR:VOLT:LEV:IMM:AMPL 1", {0});
+  }
+  Measure("optional", "16 cmds, shortest", *expanded, shortest);
+  Measure("optional", "16 cmds, longest", *expanded, longest);
+  Measure("optional", "1 cmd, shortest", *optional, shortest);
+  Measure("optional", "1 cmd, longest", *optional, optional_longest);
+}
+#endif
+
+struct Suite {
+  const char* name;
+  void (*run)();
+};
+
+const Suite suites[] = {
+  {"ieee", &IeeeSuite},
+  {"table", &TableSuite},
+  {"tokens", &TokensSuite},
+  {"depth", &DepthSuite},
+  {"length", &LengthSuite},
+  {"lexer", &LexerSuite},
+  {"decode", &DecodeSuite},
+  {"register", &RegisterSuite},
+  {"pipeline", &PipelineSuite},
+  {"response", &ResponseSuite},
+  #if SCPI_BLOCK_DATA
+  {"block", &BlockSuite},
+  #endif
+  {"threads", &ThreadsSuite},
+  {"polling", &PollingSuite},
+  #if SCPI_HANDLER_CONTEXT
+  {"handlers", &HandlersSuite},
+  #endif
+  {"suffixes", &SuffixesSuite},
+  #if SCPI_ERROR_QUEUE_LENGTH
+  {"errors", &ErrorsSuite},
+  #endif
+  #if SCPI_MAX_STREAMS
+  {"streams", &StreamsSuite},
+  #endif
+  #if SCPI_OPTIONAL_NODES
+  {"optional", &OptionalSuite},
+  #endif
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+  HandlerTable<kHandlers>::Fill();
+  std::vector<std::string> selected;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--quick") {
+      target_seconds = 0.02;
+    } else {
+      selected.push_back(arg);
+    }
+  }
+  PrintHeader();
+  for (const Suite& suite : suites) {
+    if (selected.empty() or (std::find(selected.begin(), selected.end(),
+                                       suite.name) != selected.end()))
+      suite.run();
+  }
+  return 0;
+}
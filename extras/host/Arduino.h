@@ -0,0 +1,252 @@
+/*!
+@file Arduino.h
+Minimal Arduino core stand-in for host (Linux) builds.
+
+Only the parts of the Arduino API used by the Vrekrer_scpi_parser library,
+its examples and the benchmarks are provided:
+ \li Fixed width integer types, \c byte and the \c PROGMEM / \c F() helpers.
+ \li \c millis(), \c micros() and \c delay() using the host steady clock.
+ \li The \c Print and \c Stream interfaces, and a minimal \c String class.
+
+This file is not used when building for an Arduino board.
+*/
+
+#ifndef VREKRER_SCPI_HOST_ARDUINO_H_
+#define VREKRER_SCPI_HOST_ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <chrono>
+#include <string>
+#include <thread>
+
+typedef uint8_t byte;
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+// ## Flash memory helpers (flash is plain memory on the host) ##
+
+class __FlashStringHelper;
+#define PROGMEM
+#define PSTR(s) (s)
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(PSTR(s)))
+#define strcpy_P(dest, src) strcpy((dest), (src))
+#define strncpy_P(dest, src, n) strncpy((dest), (src), (n))
+#define strlen_P(src) strlen(src)
+#define strcmp_P(a, b) strcmp((a), (b))
+#define memcpy_P(dest, src, n) memcpy((dest), (src), (n))
+#define pgm_read_byte(addr) (*reinterpret_cast<const uint8_t*>(addr))
+#define pgm_read_word(addr) (*reinterpret_cast<const uint16_t*>(addr))
+#define pgm_read_dword(addr) (*reinterpret_cast<const uint32_t*>(addr))
+#define pgm_read_ptr(addr) (*reinterpret_cast<void* const*>(addr))
+
+// ## Time functions ##
+
+inline std::chrono::steady_clock::time_point ArduinoHostStartTime_() {
+  static const std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+  return start;
+}
+
+///Milliseconds since the program started.
+inline unsigned long millis() {
+  return (unsigned long) std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now() - ArduinoHostStartTime_()).count();
+}
+
+///Microseconds since the program started.
+inline unsigned long micros() {
+  return (unsigned long) std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - ArduinoHostStartTime_()).count();
+}
+
+///Pauses the program for the given time, in milliseconds.
+inline void delay(unsigned long ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+// ## String ##
+
+/*!
+ Minimal Arduino String class.
+*/
+class String {
+ public:
+  String(const char* value = "") : value_(value ? value : "") {}
+  String(const __FlashStringHelper* value)
+    : value_(reinterpret_cast<const char*>(value)) {}
+  String(char value) : value_(1, value) {}
+  String(long value, unsigned char base = DEC) { FromNumber_(value, base); }
+  String(int value, unsigned char base = DEC) {
+    FromNumber_((long)value, base);
+  }
+  String(unsigned int value, unsigned char base = DEC) {
+    FromNumber_((unsigned long)value, base);
+  }
+  String(unsigned long value, unsigned char base = DEC) {
+    FromNumber_(value, base);
+  }
+  String(double value, unsigned char digits = 2) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+    value_ = buffer;
+  }
+  const char* c_str() const { return value_.c_str(); }
+  unsigned int length() const { return value_.length(); }
+  long toInt() const { return atol(value_.c_str()); }
+  float toFloat() const { return atof(value_.c_str()); }
+  void toUpperCase() { for (char& c : value_) c = toupper(c); }
+  void toLowerCase() { for (char& c : value_) c = tolower(c); }
+  bool startsWith(const String& prefix) const {
+    return value_.compare(0, prefix.value_.size(), prefix.value_) == 0;
+  }
+  bool operator==(const String& other) const { return value_ == other.value_; }
+  bool operator!=(const String& other) const { return value_ != other.value_; }
+  String& operator+=(const String& other) {
+    value_ += other.value_;
+    return *this;
+  }
+
+ private:
+  void FromNumber_(long value, unsigned char base) {
+    if ((base == DEC) and (value < 0)) {
+      FromNumber_((unsigned long)(-value), base);
+      value_.insert(value_.begin(), '-');
+    } else {
+      FromNumber_((unsigned long)value, base);
+    }
+  }
+  void FromNumber_(unsigned long value, unsigned char base) {
+    char buffer[8 * sizeof(long) + 1];
+    char* digit = &buffer[sizeof(buffer) - 1];
+    *digit = '\0';
+    if (base < 2) base = 10;
+    do {
+      char c = value % base;
+      value /= base;
+      *--digit = c < 10 ? c + '0' : c + 'A' - 10;
+    } while (value);
+    value_ = digit;
+  }
+  std::string value_;
+};
+
+// ## Print ##
+
+/*!
+ Arduino Print interface.
+
+ Derived classes must implement \c write(uint8_t).
+*/
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) n += write(*buffer++);
+    return n;
+  }
+  size_t write(const char* str) {
+    if (str == NULL) return 0;
+    return write((const uint8_t*)str, strlen(str));
+  }
+  size_t write(const char* buffer, size_t size) {
+    return write((const uint8_t*)buffer, size);
+  }
+  virtual int availableForWrite() { return 0; }
+  virtual void flush() {}
+
+  size_t print(const __FlashStringHelper* value) {
+    return write(reinterpret_cast<const char*>(value));
+  }
+  size_t print(const String& value) { return write(value.c_str()); }
+  size_t print(const char* value) { return write(value); }
+  size_t print(char value) { return write((uint8_t)value); }
+  size_t print(unsigned char value, int base = DEC) {
+    return print((unsigned long)value, base);
+  }
+  size_t print(int value, int base = DEC) { return print((long)value, base); }
+  size_t print(unsigned int value, int base = DEC) {
+    return print((unsigned long)value, base);
+  }
+  size_t print(long value, int base = DEC) {
+    return write(String(value, (unsigned char)base).c_str());
+  }
+  size_t print(unsigned long value, int base = DEC) {
+    return write(String(value, (unsigned char)base).c_str());
+  }
+  size_t print(long long value, int base = DEC) {
+    return print((long)value, base);
+  }
+  size_t print(unsigned long long value, int base = DEC) {
+    return print((unsigned long)value, base);
+  }
+  size_t print(double value, int digits = 2) {
+    return write(String(value, (unsigned char)digits).c_str());
+  }
+
+  size_t println() { return write("\r\n"); }
+  template <typename T>
+  size_t println(const T& value) {
+    size_t n = print(value);
+    return n + println();
+  }
+  template <typename T>
+  size_t println(const T& value, int format) {
+    size_t n = print(value, format);
+    return n + println();
+  }
+};
+
+// ## Stream ##
+
+/*!
+ Arduino Stream interface.
+
+ Derived classes must implement \c available(), \c read(), \c peek() and
+ \c write(uint8_t).
+*/
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long timeout) { timeout_ = timeout; }
+  unsigned long getTimeout() { return timeout_; }
+
+  virtual size_t readBytes(char* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+      int c = TimedRead_();
+      if (c < 0) break;
+      *buffer++ = (char)c;
+      count++;
+    }
+    return count;
+  }
+  size_t readBytes(uint8_t* buffer, size_t length) {
+    return readBytes((char*)buffer, length);
+  }
+
+ protected:
+  int TimedRead_() {
+    unsigned long start = millis();
+    do {
+      int c = read();
+      if (c >= 0) return c;
+    } while (millis() - start < timeout_);
+    return -1;
+  }
+  unsigned long timeout_ = 1000;
+};
+
+#endif //VREKRER_SCPI_HOST_ARDUINO_H_
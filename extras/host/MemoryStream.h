@@ -0,0 +1,75 @@
+/*!
+@file MemoryStream.h
+In-memory Stream used for host (Linux) builds.
+*/
+
+#ifndef VREKRER_SCPI_HOST_MEMORY_STREAM_H_
+#define VREKRER_SCPI_HOST_MEMORY_STREAM_H_
+
+#include "Arduino.h"
+
+/*!
+ In-memory Stream.
+
+ Input is read from a user provided buffer (see \c SetInput and \c Rewind). \n
+ Output is counted and, if \c capture_output is true, appended to \c output.
+*/
+class MemoryStream : public Stream {
+ public:
+  ///Sets the data to be read. The buffer is not copied.
+  void SetInput(const char* data, size_t length) {
+    input_ = data;
+    input_length_ = length;
+    position_ = 0;
+  }
+  ///Restarts reading from the beginning of the input.
+  void Rewind() { position_ = 0; }
+  ///Number of input bytes not read yet.
+  size_t Remaining() const { return input_length_ - position_; }
+
+  int available() override { return (int)(input_length_ - position_); }
+  int read() override {
+    if (position_ >= input_length_) return -1;
+    return (unsigned char)input_[position_++];
+  }
+  int peek() override {
+    if (position_ >= input_length_) return -1;
+    return (unsigned char)input_[position_];
+  }
+  size_t readBytes(char* buffer, size_t length) override {
+    if (length > Remaining()) length = Remaining();
+    memcpy(buffer, input_ + position_, length);
+    position_ += length;
+    return length;
+  }
+
+  size_t write(uint8_t c) override {
+    return write(&c, 1);
+  }
+  size_t write(const uint8_t* buffer, size_t size) override {
+    ++write_calls;
+    bytes_written += size;
+    if (capture_output) output.append((const char*)buffer, size);
+    return size;
+  }
+  int availableForWrite() override { return write_space; }
+  using Print::write;
+
+  ///Stores the written data in \c output when true.
+  bool capture_output = false;
+  ///Written data (only if \c capture_output is true).
+  std::string output;
+  ///Number of written bytes.
+  size_t bytes_written = 0;
+  ///Number of calls to \c write.
+  size_t write_calls = 0;
+  ///Value returned by \c availableForWrite.
+  int write_space = 64;
+
+ private:
+  const char* input_ = "";
+  size_t input_length_ = 0;
+  size_t position_ = 0;
+};
+
+#endif //VREKRER_SCPI_HOST_MEMORY_STREAM_H_
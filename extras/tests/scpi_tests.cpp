@@ -0,0 +1,881 @@
+/*
+Vrekrer_scpi_parser library.
+Host regression tests.
+
+Executes messages on a Linux host, using the Arduino stand-in found in
+extras/host, and checks the called procedures and the written responses.
+The hash type is the default one (uint8_t), so hash collisions are likely.
+
+Tests:
+  path    : Header path of the message units (IEEE 488.2 7.6) for every
+            pair of the SCPI required commands (see the Configuration_Options
+            example), e.g. STAT:PRES;STAT:OPER:COND?, and relative headers
+            after *WAI and before a block parameter.
+  streams : Streamed responses to an interface that does not report its
+            free space, with a full stream table and interrupted by a new
+            message.
+  optional: Optional nodes that are optional in a command and required in
+            another, e.g. TRIGger[:SEQuence][:IMMediate] and
+            TRIGger[:SEQuence]:SOURce, and optional tokens 32 apart.
+  table   : Command table with more tokens than SCPI_MAX_TOKENS, with
+            optional nodes enabled.
+  operations: *OPC, *OPC? and *WAI, a full operations table and a block
+            received while waiting.
+  split   : Parameters with quoted strings containing ',', ';' and quotes.
+  decoders: GetInteger, GetReal, GetBoolean and GetChoice, including MIN,
+            MAX, DEF, units and their errors.
+  blocks  : Definite and indefinite length blocks, with ';' and '\n' in the
+            data and longer than the message buffer.
+  errors  : Error queue, its -350 overflow and PushError.
+  feed    : Messages split across Feed calls, overflow and timeout.
+  suffixes: Numeric suffixes, also from the header path.
+  hash    : FixHashCrashes with magic numbers that produce hash crashes.
+  sessions: Two interfaces with interleaved partial messages.
+  cache   : Header cache hits, cleared when a command is registered.
+  response: Buffered response, written once for several message units.
+  context : Procedures with a context (SCPI_Method).
+  config  : Parser with smaller sizes than the SCPI_* macros (message 
+            buffer, command depth, parameters and feature tables).
+  statistics: Calls and parse times per command, and the ErrorHandler calls
+            of the errors raised while receiving (Feed).
+
+Usage:
+  scpi_tests [test ...]
+  The exit code is the number of failed tests.
+  scpi_tests_receive runs them with a receive buffer.
+*/
+
+#define SCPI_MAX_STREAMS 2
+#define SCPI_MAX_OPERATIONS 2
+#define SCPI_BLOCK_DATA 1
+#define SCPI_OPTIONAL_NODES 1
+#define SCPI_CONST_TABLE 1
+#define SCPI_ERROR_QUEUE_LENGTH 3
+#define SCPI_ERROR_CONTEXT_LENGTH 16
+#define SCPI_HEADER_CACHE 8
+#define SCPI_HASH_SEARCH 1
+#define SCPI_HANDLER_CONTEXT 1
+#define SCPI_RESPONSE_BUFFER_LENGTH 64
+#define SCPI_STATISTICS 1
+
+#include "Arduino.h"
+#include "MemoryStream.h"
+#include "Vrekrer_scpi_parser.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace {
+
+//Parser with more than 32 tokens, 32 bits hashes avoid hash crashes.
+struct WideConfig : SCPI_Parser_Config {
+  static const uint8_t max_tokens = 64;
+  static const uint16_t token_buffer_length = 512;
+  static const uint8_t max_commands = 40;
+  using hash_type = uint32_t;
+};
+
+//Parser smaller than SCPI_Parser in every size.
+struct SmallConfig : SCPI_Parser_Config {
+  static const uint8_t max_tokens = 4;
+  static const uint16_t token_buffer_length = 32;
+  static const uint8_t max_commands = 4;
+  static const scpi_length_t buffer_length = 16;
+  static const uint8_t max_command_depth = 2;
+  static const uint8_t max_parameters = 1;
+  static const uint8_t max_operations = 1;
+  static const uint16_t wait_queue_length = 16;
+  static const uint8_t max_streams = 1;
+};
+
+int failed_checks = 0;
+
+//Reports a failed check of a test.
+void Check(const char* test, bool passed, const std::string& detail) {
+  if (passed) return;
+  fprintf(stderr, "%s: FAILED %s\n", test, detail.c_str());
+  ++failed_checks;
+}
+
+//Indexes of the procedures called by the messages (see Called).
+std::vector<int> calls;
+
+//Procedure number N, records its call.
+template <int N>
+void Called(SCPI_C, SCPI_P, Stream&) {
+  calls.push_back(N);
+}
+
+//Executes a message (a copy), the called procedures are in calls.
+template <class Parser>
+void Execute(Parser& parser, const std::string& message, Stream& interface) {
+  char buffer[SCPI_BUFFER_LENGTH + 1];
+  snprintf(buffer, sizeof(buffer), "%s", message.c_str());
+  calls.clear();
+  parser.Execute(buffer, interface);
+}
+
+//Called procedures as text, e.g. "8,0".
+std::string CallsText() {
+  std::string text;
+  for (int call : calls) {
+    if (not text.empty()) text += ',';
+    text += std::to_string(call);
+  }
+  return text;
+}
+
+//Parser used by the procedures that call it (operations and streams)
+SCPI_Parser* test_parser = NULL;
+
+//Completion of the operation started by StartWait.
+bool operation_done = false;
+
+bool PollWait() {
+  return operation_done;
+}
+
+//Result of the last StartOperation of StartWait.
+bool operation_started = false;
+
+//Procedure number 3, starts an overlapped operation.
+void StartWait(SCPI_C, SCPI_P, Stream&) {
+  operation_started = test_parser->StartOperation(&PollWait);
+  calls.push_back(3);
+}
+
+void PathTest() {
+  const char* commands[][2] = {
+    {"STATus:OPERation", ":CONDition?"},
+    {"STATus:OPERation", ":ENABle"},
+    {"STATus:OPERation", ":EVENt?"},
+    {"STATus:QUEStionable", ":CONDition?"},
+    {"STATus:QUEStionable", ":ENABle"},
+    {"STATus:QUEStionable", ":EVENt?"},
+    {"STATus", ":OPERation?"},
+    {"STATus", ":QUEStionable?"},
+    {"STATus", ":PRESet"},
+    {"SYSTem", ":ERRor?"},
+    {"SYSTem", ":ERRor:NEXT?"},
+    {"SYSTem", ":VERSion?"},
+  };
+  const char* headers[] = {
+    "STAT:OPER:COND?", "STAT:OPER:ENAB", "STAT:OPER:EVEN?",
+    "STAT:QUES:COND?", "STAT:QUES:ENAB", "STAT:QUES:EVEN?",
+    "STAT:OPER?", "STAT:QUES?", "STAT:PRES",
+    "SYST:ERR?", "SYST:ERR:NEXT?", "SYST:VERS?",
+  };
+  const SCPI_caller_t callers[] = {
+    &Called<0>, &Called<1>, &Called<2>, &Called<3>, &Called<4>, &Called<5>,
+    &Called<6>, &Called<7>, &Called<8>, &Called<9>, &Called<10>, &Called<11>,
+  };
+  SCPI_Parser parser;
+  for (int i = 0; i < 12; i++) {
+    parser.SetCommandTreeBase(commands[i][0]);
+    parser.RegisterCommand(commands[i][1], callers[i]);
+  }
+  parser.SetCommandTreeBase("");
+  MemoryStream interface;
+  //Full headers after another command of the same tree
+  for (int i = 0; i < 12; i++) {
+    for (int j = 0; j < 12; j++) {
+      std::string message = std::string(headers[i]) + ";" + headers[j];
+      Execute(parser, message, interface);
+      std::string expected = std::to_string(i) + "," + std::to_string(j);
+      Check("path", CallsText() == expected,
+            message + " called " + CallsText() + ", not " + expected);
+    }
+  }
+  //Relative headers
+  Execute(parser, "STAT:OPER:COND?;ENAB 1;EVEN?", interface);
+  Check("path", CallsText() == "0,1,2",
+        "STAT:OPER:COND?;ENAB 1;EVEN? called " + CallsText());
+  Execute(parser, "STAT:QUES:ENAB 1;COND?;:STAT:PRES", interface);
+  Check("path", CallsText() == "4,3,8",
+        "STAT:QUES:ENAB 1;COND?;:STAT:PRES called " + CallsText());
+
+  //Relative headers queued after *WAI, and before a block parameter
+  SCPI_Parser split_parser;
+  test_parser = &split_parser;
+  split_parser.RegisterCommand("SOURce:VOLTage", &Called<0>);
+  split_parser.RegisterCommand("SOURce:CURRent", &Called<1>);
+  split_parser.RegisterCommand("SOURce:DATA", &Called<2>);
+  split_parser.RegisterCommand("STARt", &StartWait);
+  operation_done = false;
+  Execute(split_parser, "STAR;SOUR:VOLT 1;*WAI;CURR 2", interface);
+  std::string before = CallsText();
+  operation_done = true;
+  calls.clear();
+  split_parser.PollOperations();
+  Check("path", (before == "3,0") and (CallsText() == "1"),
+        "STAR;SOUR:VOLT 1;*WAI;CURR 2 called " + before + " and " 
+        + CallsText());
+  interface.SetInput("SOUR:VOLT 1;DATA #14abcd\n", 25);
+  calls.clear();
+  split_parser.ProcessInput(interface, "\n");
+  Check("path", CallsText() == "0,2",
+        "SOUR:VOLT 1;DATA #14abcd called " + CallsText());
+}
+
+//Result of the last StreamResponse of the streams test.
+bool stream_started = false;
+
+//Produces "0123456789" repeated.
+size_t Digits(char* buffer, size_t size, uint32_t position) {
+  for (size_t i = 0; i < size; i++) buffer[i] = '0' + (position + i) % 10;
+  return size;
+}
+
+void StreamDigits(SCPI_C, SCPI_P, Stream& interface) {
+  stream_started = test_parser->StreamResponse(interface, &Digits, 200);
+  calls.push_back(0);
+}
+
+//The 200 chars streamed by StreamDigits.
+std::string DigitsText() {
+  std::string text;
+  for (int i = 0; i < 200; i++) text += char('0' + i % 10);
+  return text + "\n";
+}
+
+void StreamsTest() {
+  SCPI_Parser parser;
+  test_parser = &parser;
+  parser.RegisterCommand("TRACe?", &StreamDigits);
+  parser.RegisterCommand("*IDN?", &Called<1>);
+  //An interface that reports 0 free chars is written with blocking writes
+  MemoryStream silent;
+  silent.write_space = 0;
+  silent.capture_output = true;
+  silent.SetInput("TRAC?\n", 6);
+  parser.ProcessInput(silent, "\n");
+  Check("streams", stream_started, "TRAC? not started");
+  bool completed = parser.PollResponses();
+  Check("streams", completed and (silent.output == DigitsText()),
+        "0 free chars, written: " + silent.output);
+
+  //A stream for each interface fills the table, the next one is refused
+  MemoryStream interfaces[3];
+  for (MemoryStream& interface : interfaces) {
+    interface.write_space = 16;
+    interface.capture_output = true;
+    Execute(parser, "TRAC?", interface);
+  }
+  Check("streams", not stream_started and interfaces[2].output.empty(),
+        "full table, third stream written: " + interfaces[2].output);
+  for (int i = 0; (i < 100) and not parser.PollResponses(); i++) {}
+  for (int i = 0; i < 2; i++) 
+    Check("streams", interfaces[i].output == DigitsText(),
+          "full table, written: " + interfaces[i].output);
+
+  //A new message interrupts the stream (Query INTERRUPTED)
+  MemoryStream interface;
+  interface.write_space = 16;
+  interface.capture_output = true;
+  Execute(parser, "TRAC?", interface);
+  parser.PollResponses();
+  parser.last_error = SCPI_Parser::ErrorCode::NoError;
+  Execute(parser, "*IDN?", interface);
+  Check("streams", 
+        (interface.output == "0123456789012345\n") and (CallsText() == "1")
+        and (parser.last_error == SCPI_Parser::ErrorCode::QueryInterrupted)
+        and parser.PollResponses(),
+        "interrupted, written: " + interface.output);
+}
+
+void OptionalTest() {
+  SCPI_Parser parser;
+  parser.RegisterCommand("[SOURce]:VOLTage", &Called<0>);
+  parser.RegisterCommand("TRIGger[:SEQuence]:SOURce", &Called<1>);
+  parser.RegisterCommand("TRIGger[:SEQuence][:IMMediate]", &Called<2>);
+  parser.RegisterCommand("MEASure[:SCALar]:VOLTage?", &Called<3>);
+  parser.RegisterCommand("MEASure:CURRent[:DC]?", &Called<4>);
+  parser.RegisterCommand("SCALar:VOLTage?", &Called<5>);
+  const char* messages[][2] = {
+    {"VOLT", "0"}, {"SOUR:VOLT", "0"},
+    {"TRIG:SOUR", "1"}, {"TRIG:SEQ:SOUR", "1"},
+    {"TRIG", "2"}, {"TRIG:IMM", "2"}, {"TRIG:SEQ", "2"}, {"TRIG:SEQ:IMM", "2"},
+    {"MEAS:VOLT?", "3"}, {"MEAS:SCAL:VOLT?", "3"},
+    {"MEAS:CURR?", "4"}, {"MEAS:CURR:DC?", "4"},
+    {"SCAL:VOLT?", "5"},
+    {"TRIG:SOUR:IMM", ""}, {"SOUR", ""}, {"MEAS:DC?", ""},
+  };
+  MemoryStream interface;
+  for (auto& message : messages) {
+    Execute(parser, message[0], interface);
+    Check("optional", CallsText() == message[1],
+          std::string(message[0]) + " called " + CallsText() 
+          + ", not " + message[1]);
+  }
+
+  //Optional tokens 32 apart (SCALar is the token 1 and BOGus the token 33)
+  SCPI_Basic_Parser<WideConfig> wide_parser;
+  wide_parser.RegisterCommand("MEASure[:SCALar]:VOLTage?", &Called<0>);
+  for (int i = 0; i < 29; i++) {
+    char filler[] = {'F', char('A' + i / 26), char('A' + i % 26), '\0'};
+    wide_parser.RegisterCommand(filler, &Called<2>);
+  }
+  wide_parser.RegisterCommand("OTHer[:BOGus]", &Called<1>);
+  const char* wide_messages[][2] = {
+    {"MEAS:SCAL:VOLT?", "0"}, {"OTH:BOG", "1"}, {"OTH", "1"},
+    {"MEAS:BOG:VOLT?", ""}, {"OTH:SCAL", ""},
+  };
+  for (auto& message : wide_messages) {
+    Execute(wide_parser, message[0], interface);
+    Check("optional", CallsText() == message[1],
+          std::string(message[0]) + " called " + CallsText() 
+          + ", not " + message[1]);
+  }
+}
+
+//26 tokens, more than SCPI_MAX_TOKENS (15)
+const char table_tokens[] PROGMEM = "AAA:BBB:CCC:DDD:EEE:FFF:GGG:HHH:III:"
+    "JJJ:KKK:LLL:MMM:NNN:OOO:PPP:QQQ:RRR:SSS:TTT:UUU:VVV:WWW:XXX:YYY:ZZZ";
+constexpr SCPI_Const_Command table_commands[] = {
+  {"AAA", &Called<0>},
+  {"YYY:ZZZ?", &Called<1>},
+  {"ZZZ", &Called<2>},
+};
+constexpr auto command_table PROGMEM = SCPI_MakeConstTable(table_tokens,
+                                                           table_commands);
+
+void TableTest() {
+  SCPI_Parser parser;
+  parser.SetCommandTable(command_table);
+  const char* messages[][2] = {
+    {"AAA", "0"}, {"YYY:ZZZ?", "1"}, {"ZZZ", "2"}, {"ZZZ;YYY:ZZZ?", "2,1"},
+    {"BBB", ""}, {"ZZZ:YYY", ""},
+  };
+  MemoryStream interface;
+  for (auto& message : messages) {
+    Execute(parser, message[0], interface);
+    Check("table", CallsText() == message[1],
+          std::string(message[0]) + " called " + CallsText() 
+          + ", not " + message[1]);
+  }
+}
+
+void OperationsTest() {
+  SCPI_Parser parser;
+  test_parser = &parser;
+  parser.RegisterCommand("STARt", &StartWait);
+  parser.RegisterCommand("*IDN?", &Called<1>);
+  parser.RegisterCommand("DATA", &Called<2>);
+  MemoryStream interface;
+  interface.capture_output = true;
+  //*OPC? without pending operations
+  Execute(parser, "*OPC?", interface);
+  Check("operations", interface.output == "1\n", 
+        "*OPC? wrote " + interface.output);
+  //*OPC sets operation_complete when the operations complete
+  operation_done = false;
+  Execute(parser, "STAR;*OPC", interface);
+  bool before = parser.operation_complete;
+  operation_done = true;
+  Check("operations", not before and parser.PollOperations() 
+                      and parser.operation_complete,
+        "*OPC did not set operation_complete");
+  //*OPC? and the next units wait for the operations
+  interface.output.clear();
+  operation_done = false;
+  Execute(parser, "STAR;*OPC?;*IDN?", interface);
+  std::string written = interface.output;
+  operation_done = true;
+  calls.clear();
+  parser.PollOperations();
+  Check("operations", written.empty() and (interface.output == "1\n")
+                      and (CallsText() == "1"),
+        "STAR;*OPC?;*IDN? wrote " + interface.output + " and called " 
+        + CallsText());
+  //A full operations table does not wait, the operation is ignored
+  operation_done = false;
+  parser.last_error = SCPI_Parser::ErrorCode::NoError;
+  Execute(parser, "STAR;STAR;STAR", interface);
+  Check("operations", not operation_started and (parser.last_error 
+                      == SCPI_Parser::ErrorCode::OperationIgnored),
+        "third STAR was started");
+  //A block received while waiting is discarded, it does not wait
+  Execute(parser, "*WAI", interface);
+  interface.SetInput("DATA #14abcd\n*IDN?\n", 19);
+  calls.clear();
+  parser.ProcessAllInput(interface, "\n");
+  bool discarded = calls.empty() 
+      and (parser.last_error == SCPI_Parser::ErrorCode::BufferOverflow);
+  operation_done = true;
+  parser.PollOperations();
+  Check("operations", discarded and (CallsText() == "1"),
+        "DATA #14abcd while waiting called " + CallsText());
+}
+
+//Parameters received by Record, separated by '|'.
+std::string recorded;
+
+//Procedure number 4, records its parameters.
+void Record(SCPI_C, SCPI_P parameters, Stream&) {
+  recorded.clear();
+  for (uint8_t i = 0; i < parameters.Size(); i++) {
+    if (i > 0) recorded += '|';
+    recorded += parameters[i];
+  }
+  calls.push_back(4);
+}
+
+void SplitTest() {
+  SCPI_Parser parser;
+  parser.RegisterCommand("TEXT", &Record);
+  parser.RegisterCommand("*IDN?", &Called<1>);
+  const char* messages[][3] = {
+    {"TEXT \"a;b,c\",2;*IDN?", "4,1", "\"a;b,c\"|2"},
+    {"TEXT 'say \"hi\"','x;y'", "4", "'say \"hi\"'|'x;y'"},
+    {"TEXT \"it's \"\"ok\"\";\",1", "4", "\"it's \"\"ok\"\";\"|1"},
+    {"TEXT 1,\"2\";TEXT \"3\"", "4,4", "\"3\""},
+  };
+  MemoryStream interface;
+  for (auto& message : messages) {
+    recorded.clear();
+    Execute(parser, message[0], interface);
+    Check("split", (CallsText() == message[1]) and (recorded == message[2]),
+          std::string(message[0]) + " called " + CallsText() 
+          + " with " + recorded);
+  }
+}
+
+//Result of the last decoder, the value or "E" and the ErrorCode.
+std::string decoded;
+
+//Error of the last decoder, e.g. "E4".
+std::string DecoderError() {
+  return "E" + std::to_string(int(test_parser->last_error));
+}
+
+void DecodeInteger(SCPI_C, SCPI_P parameters, Stream& interface) {
+  long value = 5;
+  decoded = test_parser->GetInteger(parameters, 0, value, -10, 100, interface)
+            ? std::to_string(value) : DecoderError();
+}
+
+void DecodeReal(SCPI_C, SCPI_P parameters, Stream& interface) {
+  float value = 1;
+  if (test_parser->GetReal(parameters, 0, value, -10, 10, "V", interface)) {
+    char text[16];
+    snprintf(text, sizeof(text), "%g", value);
+    decoded = text;
+  } else {
+    decoded = DecoderError();
+  }
+}
+
+void DecodeBoolean(SCPI_C, SCPI_P parameters, Stream& interface) {
+  bool value = false;
+  decoded = test_parser->GetBoolean(parameters, 0, value, interface)
+            ? std::to_string(value) : DecoderError();
+}
+
+void DecodeChoice(SCPI_C, SCPI_P parameters, Stream& interface) {
+  uint8_t value = 9;
+  decoded = test_parser->GetChoice(parameters, 0, "BUS|IMMediate|EXTernal",
+                                   value, interface)
+            ? std::to_string(value) : DecoderError();
+}
+
+void DecodersTest() {
+  SCPI_Parser parser;
+  test_parser = &parser;
+  parser.RegisterCommand("INTeger", &DecodeInteger);
+  parser.RegisterCommand("REAL", &DecodeReal);
+  parser.RegisterCommand("BOOLean", &DecodeBoolean);
+  parser.RegisterCommand("CHOice", &DecodeChoice);
+  //E4 MissingParameter, E5 InvalidParameter, E6 OutOfRange
+  const char* messages[][2] = {
+    {"INT 12", "12"}, {"INT -1.6", "-2"}, {"INT 1e1", "10"},
+    {"INT MAX", "100"}, {"INT min", "-10"}, {"INT DEF", "5"},
+    {"INT 200", "E6"}, {"INT 12abc", "E5"}, {"INT", "E4"},
+    {"REAL 2.5", "2.5"}, {"REAL 5mV", "0.005"}, {"REAL -1.5e-1 V", "-0.15"},
+    {"REAL MAX", "10"}, {"REAL 20", "E6"}, {"REAL 3 A", "E5"},
+    {"BOOL ON", "1"}, {"BOOL off", "0"}, {"BOOL 0.4", "0"}, {"BOOL 0.6", "1"},
+    {"BOOL maybe", "E5"},
+    {"CHO BUS", "0"}, {"CHO imm", "1"}, {"CHO EXTERNAL", "2"},
+    {"CHO IMME", "E5"}, {"CHO", "E4"},
+  };
+  MemoryStream interface;
+  for (auto& message : messages) {
+    decoded.clear();
+    Execute(parser, message[0], interface);
+    Check("decoders", decoded == message[1],
+          std::string(message[0]) + " decoded " + decoded + ", not " 
+          + message[1]);
+  }
+  test_parser = NULL;
+}
+
+//Data read by ReadBlock from the block parameter.
+std::string block;
+
+//Procedure number 5, reads the block of the last parameter.
+void ReadBlock(SCPI_C, SCPI_P, Stream& interface) {
+  block.clear();
+  for (int c = interface.read(); c >= 0; c = interface.read()) 
+    block += char(c);
+  calls.push_back(5);
+}
+
+void BlocksTest() {
+  SCPI_Parser parser;
+  parser.RegisterCommand("DATA", &ReadBlock);
+  parser.RegisterCommand("*IDN?", &Called<1>);
+  std::string large(100, 'x');
+  std::string messages[][3] = {
+    {"DATA #15a;b\nc\n*IDN?\n", "5,1", "a;b\nc"},
+    {"*IDN?;DATA #0a;b\n", "1,5", "a;b"},
+    {"DATA #3100" + large + "\n*IDN?\n", "5,1", large},
+  };
+  MemoryStream interface;
+  for (auto& message : messages) {
+    interface.SetInput(message[0].data(), message[0].size());
+    calls.clear();
+    block.clear();
+    parser.ProcessAllInput(interface, "\n");
+    Check("blocks", (CallsText() == message[1]) and (block == message[2]),
+          message[0] + " called " + CallsText() + " and read " + block);
+  }
+}
+
+//Errors of the queue, printed with PrintNextError.
+template <class Parser>
+std::string PrintErrors(Parser& parser) {
+  MemoryStream interface;
+  interface.capture_output = true;
+  while (parser.ErrorCount() > 0) parser.PrintNextError(interface);
+  return interface.output;
+}
+
+void ErrorsTest() {
+  SCPI_Parser parser;
+  MemoryStream interface;
+  interface.capture_output = true;
+  parser.PrintNextError(interface);
+  Check("errors", interface.output == "0,\"No error\"\r\n",
+        "empty queue printed " + interface.output);
+  //4 errors, the last entry of the queue (3) is replaced by -350
+  Execute(parser, "BAD1;BAD2;BAD3;BAD4", interface);
+  std::string errors = PrintErrors(parser);
+  Check("errors", errors == "-113,\"Undefined header;BAD1\"\r\n"
+                            "-113,\"Undefined header;BAD2\"\r\n"
+                            "-350,\"Queue overflow\"\r\n",
+        "BAD1;BAD2;BAD3;BAD4 queued " + errors);
+  parser.PushError(201, "Hot");
+  parser.PushError(-222);
+  errors = PrintErrors(parser);
+  Check("errors", errors == "201,\"Hot\"\r\n-222,\"Data out of range\"\r\n",
+        "PushError queued " + errors);
+  Execute(parser, "BAD", interface);
+  parser.ClearErrors();
+  Check("errors", parser.ErrorCount() == 0, "ClearErrors left errors");
+}
+
+void FeedTest() {
+  SCPI_Parser parser;
+  parser.RegisterCommand("SYSTem:ERRor?", &Called<0>);
+  parser.RegisterCommand("*IDN?", &Called<1>);
+  MemoryStream interface;
+  //A message in several chunks, and several messages in a chunk
+  const char* chunks[] = {"SYST:", "ERR", "?\r", "\n*IDN?\r\n*I", "DN?\r\n"};
+  calls.clear();
+  for (const char* chunk : chunks) 
+    parser.Feed(chunk, strlen(chunk), interface, "\r\n", 0);
+  Check("feed", CallsText() == "0,1,1", "chunks called " + CallsText());
+  //Overflow, the chars after the overflow start a new message
+  std::string data = std::string(80, 'A') + "\n*IDN?\n";
+  calls.clear();
+  parser.ClearErrors();
+  parser.Feed(data.data(), data.size(), interface, "\n", 0);
+  std::string errors = PrintErrors(parser);
+  Check("feed", (CallsText() == "1") and (errors.substr(0, 5) == "-363,")
+                and (errors.find("-113,") != std::string::npos),
+        "overflow called " + CallsText() + " and queued " + errors);
+  //Timeout, counted from the last fed chars
+  calls.clear();
+  parser.timeout = 10;
+  parser.Feed("*ID", 3, interface, "\n", 100);
+  parser.Feed("N?\n", 3, interface, "\n", 120);
+  errors = PrintErrors(parser);
+  Check("feed", calls.empty() and (errors.substr(0, 5) == "-365,"),
+        "timeout called " + CallsText() + " and queued " + errors);
+}
+
+//Suffixes received by RecordSuffixes, e.g. "2,3".
+void RecordSuffixes(SCPI_C commands, SCPI_P, Stream&) {
+  recorded = std::to_string(commands.Suffix(0)) + "," 
+             + std::to_string(commands.Suffix(1));
+}
+
+void SuffixesTest() {
+  SCPI_Parser parser;
+  parser.RegisterCommand("OUTPut#:CHANnel#", &RecordSuffixes);
+  parser.RegisterCommand("OUTPut#:CHANnel#:VOLTage", &RecordSuffixes);
+  parser.RegisterCommand("SYSTem:CHANnel#", &RecordSuffixes);
+  const char* messages[][2] = {
+    {"OUTP2:CHAN3", "2,3"}, {"OUTP:CHAN12", "1,12"},
+    {"OUTP2:CHAN3:VOLT 1", "2,3"}, {"OUTP4:CHAN5;CHAN6", "4,6"},
+    {"OUTP7:CHAN8:VOLT 1;VOLT 2", "7,8"}, {"SYST:CHAN9", "0,9"},
+    {"OUTP65536:CHAN0", "65535,0"},
+  };
+  MemoryStream interface;
+  for (auto& message : messages) {
+    recorded.clear();
+    Execute(parser, message[0], interface);
+    Check("suffixes", recorded == message[1],
+          std::string(message[0]) + " got " + recorded + ", not " 
+          + message[1]);
+  }
+}
+
+void HashTest() {
+  //Magic numbers 1 and 0 give the same hash to AAA:BBB and BBB:AAA
+  SCPI_Parser parser;
+  parser.hash_magic_number = 1;
+  parser.hash_magic_offset = 0;
+  const char* headers[] = {"AAA:BBB", "BBB:AAA", "AAA:AAA", "BBB:BBB"};
+  const SCPI_caller_t callers[] = {
+    &Called<0>, &Called<1>, &Called<2>, &Called<3>,
+  };
+  for (int i = 0; i < 4; i++) parser.RegisterCommand(headers[i], callers[i]);
+  MemoryStream interface;
+  Execute(parser, "BBB:AAA", interface);
+  Check("hash", CallsText() != "1", "no hash crash before FixHashCrashes");
+  Check("hash", parser.FixHashCrashes(), "FixHashCrashes failed");
+  for (int i = 0; i < 4; i++) {
+    Execute(parser, headers[i], interface);
+    Check("hash", CallsText() == std::to_string(i),
+          std::string(headers[i]) + " called " + CallsText());
+  }
+}
+
+void SessionsTest() {
+  SCPI_Parser parser;
+  parser.RegisterCommand("SYSTem:ERRor?", &Called<0>);
+  parser.RegisterCommand("*IDN?", &Called<1>);
+  parser.timeout = 1000;
+  SCPI_Session first_session;
+  SCPI_Session second_session;
+  MemoryStream first;
+  MemoryStream second;
+  calls.clear();
+  first.SetInput("SYST:", 5);
+  parser.ProcessInput(first_session, first, "\n");
+  second.SetInput("*ID", 3);
+  parser.ProcessInput(second_session, second, "\n");
+  first.SetInput("ERR?\n", 5);
+  parser.ProcessInput(first_session, first, "\n");
+  second.SetInput("N?\n", 3);
+  parser.ProcessInput(second_session, second, "\n");
+  Check("sessions", CallsText() == "0,1", 
+        "interleaved messages called " + CallsText());
+}
+
+void CacheTest() {
+  SCPI_Parser parser;
+  parser.RegisterCommand("MEASure:VOLTage?", &Called<0>);
+  parser.RegisterCommand("OUTPut#:CHANnel#", &RecordSuffixes);
+  MemoryStream interface;
+  Execute(parser, "MEAS:VOLT?", interface);
+  Execute(parser, "MEAS:VOLT?", interface);
+  Check("cache", (CallsText() == "0") and (parser.header_cache_hits == 1)
+                 and (parser.header_cache_misses == 1),
+        "MEAS:VOLT? twice, " + std::to_string(parser.header_cache_hits) 
+        + " hits");
+  //The suffixes are also cached
+  Execute(parser, "OUTP2:CHAN3", interface);
+  recorded.clear();
+  Execute(parser, "OUTP2:CHAN3", interface);
+  Check("cache", recorded == "2,3", "cached OUTP2:CHAN3 got " + recorded);
+  //A cached unknown header is found after its command is registered
+  Execute(parser, "NEW", interface);
+  parser.RegisterCommand("NEW", &Called<1>);
+  Execute(parser, "NEW", interface);
+  Check("cache", CallsText() == "1", "NEW called " + CallsText());
+}
+
+void AddElements(SCPI_C, SCPI_P, Stream& interface) {
+  SCPI_Response& response = static_cast<SCPI_Response&>(interface);
+  response.Add(1);
+  response.AddString("a\"b");
+}
+
+void AddReal(SCPI_C, SCPI_P, Stream& interface) {
+  SCPI_Response& response = static_cast<SCPI_Response&>(interface);
+  response.Add(2.5, 1);
+}
+
+void ResponseTest() {
+  SCPI_Parser parser;
+  parser.RegisterCommand("ELEMents?", &AddElements);
+  parser.RegisterCommand("REAL?", &AddReal);
+  parser.RegisterCommand("*IDN?", &Called<1>);
+  MemoryStream interface;
+  interface.capture_output = true;
+  Execute(parser, "ELEM?;*IDN?;REAL?", interface);
+  Check("response", (interface.output == "1,\"a\"\"b\";2.5\n") 
+                    and (interface.write_calls == 1),
+        "ELEM?;*IDN?;REAL? wrote " + interface.output + " in " 
+        + std::to_string(interface.write_calls) + " calls");
+  //Responses longer than the buffer are sent in several writes
+  interface.output.clear();
+  interface.write_calls = 0;
+  std::string message = "ELEM?";
+  std::string expected = "1,\"a\"\"b\"";
+  for (int i = 0; i < 9; i++) {
+    message += ";ELEM?";
+    expected += ";1,\"a\"\"b\"";
+  }
+  Execute(parser, message, interface);
+  Check("response", (interface.output == expected + "\n")
+                    and (interface.write_calls == 2),
+        message + " wrote " + interface.output + " in " 
+        + std::to_string(interface.write_calls) + " calls");
+}
+
+//Object used as the context of its procedures.
+struct Counter {
+  int count = 0;
+  void Count(const SCPI_Commands&, const SCPI_Parameters& parameters, 
+             Stream&) {
+    count += parameters.Size();
+  }
+};
+
+void ContextTest() {
+  SCPI_Parser parser;
+  Counter first;
+  Counter second;
+  parser.RegisterCommand("COUNt:FIRSt", &SCPI_Method<Counter, &Counter::Count>,
+                         &first);
+  parser.RegisterCommand("COUNt:SECond", 
+                         &SCPI_Method<Counter, &Counter::Count>, &second);
+  MemoryStream interface;
+  Execute(parser, "COUN:FIRS 1,2;SEC 3;FIRS 4", interface);
+  Check("context", (first.count == 3) and (second.count == 1),
+        "counted " + std::to_string(first.count) + " and " 
+        + std::to_string(second.count));
+}
+
+//Number of parameters received by CountParameters.
+int parameters_count = -1;
+
+void CountParameters(SCPI_C, SCPI_P parameters, Stream&) {
+  parameters_count = parameters.Size();
+}
+
+void ConfigTest() {
+  using SmallParser = SCPI_Basic_Parser<SmallConfig>;
+  Check("config", sizeof(SmallParser) < sizeof(SCPI_Parser),
+        "small parser is " + std::to_string(sizeof(SmallParser)) 
+        + " bytes, SCPI_Parser is " + std::to_string(sizeof(SCPI_Parser)));
+  Check("config", sizeof(SmallParser::session_t) < sizeof(SCPI_Session),
+        "small session is not smaller than SCPI_Session");
+  SmallParser parser;
+  MemoryStream interface;
+  parser.RegisterCommand("SYSTem:ERRor?", &CountParameters);
+  parser.RegisterCommand("SYSTem:ERRor:NEXT?", &Called<1>);
+  parameters_count = -1;
+  Execute(parser, "SYST:ERR? 1,2,3", interface);
+  Check("config", parameters_count == 1,
+        "SYST:ERR? 1,2,3 got " + std::to_string(parameters_count) 
+        + " parameters");
+  Execute(parser, "SYST:ERR:NEXT?", interface);
+  Check("config", calls.empty() 
+        and (parser.last_error == SmallParser::ErrorCode::UnknownCommand),
+        "a command deeper than max_command_depth was registered");
+  //Longer than buffer_length, without termination chars
+  const char data[] = "SYST:ERR? 1,2,3,4,5";
+  parser.Feed(data, sizeof(data) - 1, interface, "\n");
+  Check("config", parser.last_error == SmallParser::ErrorCode::BufferOverflow,
+        "a message longer than buffer_length did not overflow");
+}
+
+void StatisticsTest() {
+  using ErrorCode = SCPI_Parser::ErrorCode;
+  SCPI_Parser parser;
+  parser.RegisterCommand("MEASure:VOLTage?", &Called<0>);
+  parser.RegisterCommand("*IDN?", &Called<1>);
+  MemoryStream interface;
+  Execute(parser, "MEAS:VOLT?;*IDN?;MEAS:VOLT?;BOG", interface);
+  SCPI_Parser::command_statistics stats;
+  bool found = parser.GetCommandStatistics("MEASure:VOLTage?", stats);
+  Check("statistics", found and (stats.calls == 2) 
+                      and (stats.max_parse_time <= stats.parse_time)
+                      and (stats.parse_time <= parser.statistics.parse_time),
+        "MEAS:VOLT? " + std::to_string(stats.calls) + " calls, parse time "
+        + std::to_string(stats.parse_time) + " us of " 
+        + std::to_string(parser.statistics.parse_time));
+  //Timeout and overflow, raised by Feed
+  parser.timeout = 10;
+  parser.Feed("*ID", 3, interface, "\n", 100);
+  parser.Feed("N?\n", 3, interface, "\n", 120);
+  std::string data = std::string(SCPI_BUFFER_LENGTH, 'A') + "\n";
+  parser.Feed(data.data(), data.size(), interface, "\n", 120);
+  uint32_t errors = 0;
+  for (uint32_t count : parser.statistics.errors) errors += count;
+  //The last command of the list is the ErrorHandler, its calls are the
+  //fifth value from the end
+  MemoryStream list;
+  list.capture_output = true;
+  parser.PrintStatisticsList(list);
+  std::vector<std::string> values(1);
+  for (char c : list.output) {
+    if (c == ',') values.emplace_back();
+    else if (isdigit(c)) values.back() += c;
+  }
+  std::string handler_calls = values[values.size() - 5];
+  Check("statistics", 
+        (parser.statistics.errors[uint8_t(ErrorCode::Timeout)] == 1)
+        and (parser.statistics.errors[uint8_t(ErrorCode::BufferOverflow)] == 1)
+        and (handler_calls == std::to_string(errors)),
+        std::to_string(errors) + " errors, ErrorHandler called " 
+        + handler_calls + " times");
+}
+
+struct Test {
+  const char* name;
+  void (*run)();
+};
+
+const Test tests[] = {
+  {"path", &PathTest},
+  {"streams", &StreamsTest},
+  {"optional", &OptionalTest},
+  {"table", &TableTest},
+  {"operations", &OperationsTest},
+  {"split", &SplitTest},
+  {"decoders", &DecodersTest},
+  {"blocks", &BlocksTest},
+  {"errors", &ErrorsTest},
+  {"feed", &FeedTest},
+  {"suffixes", &SuffixesTest},
+  {"hash", &HashTest},
+  {"sessions", &SessionsTest},
+  {"cache", &CacheTest},
+  {"response", &ResponseTest},
+  {"context", &ContextTest},
+  {"config", &ConfigTest},
+  {"statistics", &StatisticsTest},
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+  std::vector<std::string> selected(argv + 1, argv + argc);
+  int failed_tests = 0;
+  for (const Test& test : tests) {
+    if (not (selected.empty() or (std::find(selected.begin(), selected.end(),
+                                            test.name) != selected.end())))
+      continue;
+    int failed_before = failed_checks;
+    test.run();
+    bool passed = (failed_checks == failed_before);
+    printf("%-10s %s\n", test.name, passed ? "passed" : "FAILED");
+    if (not passed) failed_tests++;
+  }
+  return failed_tests;
+}
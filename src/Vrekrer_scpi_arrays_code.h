@@ -5,13 +5,15 @@
 // ## SCPI_String_Array member functions ##
 
 ///Add indexing capability.
-char* SCPI_String_Array::operator[](const uint8_t index) const {
+template <uint8_t N>
+char* SCPI_String_Array<N>::operator[](const uint8_t index) const {
   if (index >= size_) return NULL; //Invalid index
   return values_[index];
 }
 
 ///Append new string (LIFO stack Push).
-void SCPI_String_Array::Append(char* value) {
+template <uint8_t N>
+void SCPI_String_Array<N>::Append(char* value) {
   overflow_error = (size_ >= storage_size);
   if (overflow_error) return;
   values_[size_] = value;
@@ -19,26 +21,30 @@ void SCPI_String_Array::Append(char* value) {
 }
 
 ///LIFO stack Pop
-char* SCPI_String_Array::Pop() {
+template <uint8_t N>
+char* SCPI_String_Array<N>::Pop() {
   if (size_ == 0) return NULL; //Empty array
   size_--;
   return values_[size_];
 }
 
 ///Returns the first element of the array
-char* SCPI_String_Array::First() const {
+template <uint8_t N>
+char* SCPI_String_Array<N>::First() const {
   if (size_ == 0) return NULL; //Empty array
   return values_[0];
 }
 
 ///Returns the last element of the array
-char* SCPI_String_Array::Last() const {
+template <uint8_t N>
+char* SCPI_String_Array<N>::Last() const {
   if (size_ == 0) return NULL; //Empty array
   return values_[size_ - 1];
 }
 
 ///Array size
-uint8_t SCPI_String_Array::Size() const {
+template <uint8_t N>
+uint8_t SCPI_String_Array<N>::Size() const {
   return size_;
 }
 
@@ -52,26 +58,67 @@ SCPI_Commands::SCPI_Commands(){}
  Constructor that extracts and tokenize a command from a message.  
  @param message  Message to process.
 
- The message is processed until a space, tab or the end of the string is 
- found, the rest is available at not_processed_message.  
+ The message is processed until a space, tab, ';' or the end of the string 
+ is found, the rest is available at not_processed_message.  
  The processed part is split on the ':' characters, the resulting parts 
  (tokens) are stored in the array.
 */
 SCPI_Commands::SCPI_Commands(char* message) {
-  char* token = message;
-  // Trim leading spaces and tabs
-  while (isspace(*token)) token++;
-  // Save parameters and multicommands for later
-  not_processed_message = strpbrk(token, " \t");
-  if (not_processed_message != NULL) {
-   not_processed_message[0] = '\0';
-   not_processed_message++;
+  char* header_end = this->Tokenize_(message);
+  if (*header_end != '\0') {
+    header_end[0] = '\0';
+    not_processed_message = header_end + 1;
   }
-  // Split using ':'
-  token = strtok(token, ":");
-  while (token != NULL) {
-    this->Append(token);
-    token = strtok(NULL, ":");
+}
+
+/*!
+ Numeric suffix of a level of the command path.
+ @param level  Level of the keyword, from the root (0 for the first one).
+ @return The suffix of the keyword, 1 if it was omitted, or 0 if the keyword
+ does not accept numeric suffixes.
+
+ The suffixes are converted while the command is searched, e.g. for the
+ command ``SOURce#:CHANnel#:VOLTage``, ``SOUR2:CHAN12:VOLT 1`` has the
+ suffixes 2, 12 and 0.  
+ Levels are counted from the root, so in a compound message unit (e.g.
+ ``SOUR2:CHAN3:VOLT 1;CURR 2``) the suffixes of the header path are
+ included (2, 3 and 0 for ``CURR``), even though only ``CURR`` is stored
+ in the array.  
+ The keywords of optional nodes (SCPI_OPTIONAL_NODES) are not counted, e.g.
+ for ``[ROUTe]:CHANnel#``, the channel is the level 0 of ``ROUT:CHAN2`` and
+ of ``CHAN2``.
+*/
+uint16_t SCPI_Commands::Suffix(uint8_t level) const {
+  if (level >= storage_size) return 0;
+  return suffixes_[level];
+}
+
+/*!
+ Split the header of a message unit in tokens, in a single pass.  
+ @param message  Message to process.
+ @return Pointer to the char that ends the header (a space, tab, ';' or the
+ end of the string). It is not modified, so the last token is not terminated.
+
+ Leading white spaces are skipped and every ':' found after a token is 
+ replaced by a null char. Empty tokens are ignored.
+*/
+char* SCPI_Commands::Tokenize_(char* message) {
+  char* token = NULL;
+  char* c = message;
+  while (isspace(*c)) c++;
+  for (; ; c++) {
+    if (*c == ':') {
+      if (token != NULL) {
+        c[0] = '\0';
+        this->Append(token);
+        token = NULL;
+      }
+    } else if ((*c == '\0') or (*c == ';') or (*c == ' ') or (*c == '\t')) {
+      if (token != NULL) this->Append(token);
+      return c;
+    } else if (token == NULL) {
+      token = c;
+    }
   }
 }
 
@@ -86,16 +133,53 @@ SCPI_Parameters::SCPI_Parameters(){}
  @param message[in,out]  Message to process.
 
  The message is split on the ',' characters, the resulting parts 
- (parameters) are stored in the array after trimming any start spaces.
+ (parameters) are stored in the array after trimming any start and end 
+ spaces. Quoted strings (``"..."`` or ``'...'``) are not split.  
+ The message is processed until a ';' or the end of the string is found, 
+ the rest is available at not_processed_message.
 */
 SCPI_Parameters::SCPI_Parameters(char* message) {
-  char* parameter = message;
-  // Split using ','
-  parameter = strtok(parameter, ",");
-  while (parameter != NULL) {
-    while(isspace(*parameter)) parameter++;
-    this->Append(parameter);
-    parameter = strtok(NULL, ",");
+  not_processed_message = this->Split_(message);
+}
+
+/*!
+ Split the parameters of a message unit, in a single pass.  
+ @param message[in,out]  Message to process.
+ @return Pointer to the message after the ';' that ends the parameters, or
+ NULL if the end of the string was found.
+
+ Separators (',' and ';') inside quoted strings are ignored. White spaces 
+ around the parameters are removed and empty parameters are ignored.
+*/
+char* SCPI_Parameters::Split_(char* message) {
+  if (message == NULL) return NULL;
+  char* parameter = NULL;
+  char* parameter_end = NULL;
+  for (char* c = message; ; c++) {
+    uint8_t new_char = c[0];
+    //Plain chars (above '\'' except ',' and ';') are skipped in a tight loop
+    if ((new_char > '\'') and (new_char != ',') and (new_char != ';')) {
+      if (parameter == NULL) parameter = c;
+      while (((uint8_t)c[1] > '\'') and (c[1] != ',') and (c[1] != ';')) c++;
+      parameter_end = c + 1;
+    } else if ((new_char == '"') or (new_char == '\'')) {
+      //Quoted strings end at the next quote (doubled quotes reopen them)
+      if (parameter == NULL) parameter = c;
+      char* quote_end = strchr(c + 1, new_char);
+      c = (quote_end != NULL) ? quote_end : c + strlen(c) - 1;
+      parameter_end = c + 1;
+    } else if ((new_char == ',') or (new_char == ';') or (new_char == '\0')) {
+      if (parameter != NULL) {
+        parameter_end[0] = '\0';
+        this->Append(parameter);
+        parameter = NULL;
+      }
+      if (new_char == ';') return c + 1;
+      if (new_char == '\0') return NULL;
+    } else if (not isspace(new_char)) {
+      //Other chars below '\'' (e.g. '#')
+      if (parameter == NULL) parameter = c;
+      parameter_end = c + 1;
+    }
   }
-  //TODO add support for strings parameters (do not split parameters inside "")
 }
@@ -0,0 +1,337 @@
+/*!
+@file Vrekrer_scpi_const_table.h
+Compile time command tables.
+
+This file is included in Vrekrer_scpi_parser.h if SCPI_CONST_TABLE is 1.
+Do not include it directly.
+
+A command table is built by the compiler from a tokens' list and an array of
+commands, and stored in flash. The parser uses it with
+SCPI_Parser::SetCommandTable, no tokens are stored and no hashes are calculated
+at boot time.
+
+Example:
+\code
+  const char tokens[] PROGMEM = "*IDN:SYSTem:ERRor:NEXT:CHANnel#:VOLTage";
+  constexpr SCPI_Const_Command commands[] = {
+    {"*IDN?", &Identify},
+    {"SYSTem:ERRor?", &GetError},
+    {"SYSTem:ERRor:NEXT?", &GetError},
+    {"CHANnel#:VOLTage", &SetVoltage},
+  };
+  constexpr auto command_table PROGMEM = SCPI_MakeConstTable(tokens, commands);
+  ...
+  my_instrument.SetCommandTable(command_table);
+\endcode
+
+Unknown tokens, invalid commands and hash crashes stop the compilation with
+an error that calls one of the functions documented as compile errors below.
+Optional nodes (``[:KEYWord]``) are not supported, list each form of a
+command instead.
+*/
+
+#ifndef VREKRER_SCPI_CONST_TABLE_H_
+#define VREKRER_SCPI_CONST_TABLE_H_
+
+///Tokens and hash configuration of a compile time command table.
+struct SCPI_Const_Table_Header {
+  ///Colon separated list of tokens, e.g. ``"SYSTem:ERRor:CHANnel#"``
+  const char* tokens;
+  ///Magic number used for hashing the commands
+  scpi_hash_t magic_number;
+  ///Magic offset used for hashing the commands
+  scpi_hash_t magic_offset;
+};
+
+/*!
+ Compile time command table, made with SCPI_MakeConstTable.
+ @see SCPI_Parser::SetCommandTable
+*/
+template <size_t N>
+struct SCPI_Const_Table {
+  ///Tokens and hash configuration
+  SCPI_Const_Table_Header header;
+  ///Hashes of the commands (sorted)
+  scpi_hash_t codes[N];
+  ///Procedures associated to the commands (same order as codes)
+  SCPI_caller_t callers[N];
+};
+
+//Internal functions used to build the tables
+//The rules match the ones of SCPI_Parser::FindToken_ and
+//SCPI_Parser::GetCommandCode_
+namespace scpi_const_table {
+
+// ## Compile errors ##
+// These functions are not constexpr, the compilation stops if they are used.
+
+///Compile error: a command has a keyword not found in the tokens' list.
+inline scpi_hash_t UnknownTokenInCommand() { return 0; }
+///Compile error: a command is empty or deeper than SCPI_MAX_COMMAND_DEPTH.
+inline scpi_hash_t InvalidCommandSize() { return 0; }
+///Compile error: a command hash is reserved, change the magic numbers.
+inline scpi_hash_t ReservedHashInCommand() { return 0; }
+///Compile error: two commands have the same hash, change the magic numbers
+///or the SCPI_HASH_TYPE (or a command is repeated).
+inline scpi_hash_t HashCrashInCommandTable() { return 0; }
+
+// ## Tokens ##
+
+constexpr char Upper(char c) {
+  return ((c >= 'a') and (c <= 'z')) ? char(c - 'a' + 'A') : c;
+}
+
+constexpr bool IsUpper(char c) { return (c >= 'A') and (c <= 'Z'); }
+
+constexpr bool IsDigit(char c) { return (c >= '0') and (c <= '9'); }
+
+//Length of a token or keyword (up to the next ':')
+constexpr size_t Length(const char* text) {
+  return ((*text == ':') or (*text == '\0')) ? 0 : 1 + Length(text + 1);
+}
+
+//Length of a token's short form
+constexpr size_t ShortLength(const char* token) {
+  return IsUpper(*token) ? 1 + ShortLength(token + 1) : 0;
+}
+
+//The token accepts numeric suffixes
+constexpr bool HasSuffix(const char* token) {
+  return (Length(token) > 0) and (token[Length(token) - 1] == '#');
+}
+
+//Length of a token's long form
+constexpr size_t LongLength(const char* token) {
+  return Length(token) - (HasSuffix(token) ? 1 : 0);
+}
+
+//Case insensitive comparison
+constexpr bool Equal(const char* a, const char* b, size_t length) {
+  return (length == 0)
+         or ((Upper(*a) == Upper(*b)) and Equal(a + 1, b + 1, length - 1));
+}
+
+//The keyword is the short or long form of the token
+constexpr bool Matches(const char* token, const char* keyword, size_t length,
+                       bool numeric_suffix) {
+  return (length > 0) and (HasSuffix(token) == numeric_suffix)
+         and ((length == ShortLength(token)) or (length == LongLength(token)))
+         and Equal(token, keyword, length);
+}
+
+//Start of the next token in the list
+constexpr const char* Next(const char* tokens) {
+  return (*tokens == '\0') ? tokens
+         : (*tokens == ':') ? tokens + 1 : Next(tokens + 1);
+}
+
+//Index of the first token that matches a keyword (-1 if not found)
+constexpr int Match(const char* tokens, const char* keyword, size_t length,
+                    bool numeric_suffix, int index) {
+  return (*tokens == '\0') ? -1
+         : Matches(tokens, keyword, length, numeric_suffix) ? index
+         : Match(Next(tokens), keyword, length, numeric_suffix, index + 1);
+}
+
+//Length of a keyword without its numeric suffix
+constexpr size_t StripDigits(const char* keyword, size_t length) {
+  return ((length > 0) and IsDigit(keyword[length - 1]))
+         ? StripDigits(keyword, length - 1) : length;
+}
+
+constexpr int First(int token, int other) {
+  return (token >= 0) ? token : other;
+}
+
+//Token index that matches a command keyword (see SCPI_Parser::FindToken_)
+constexpr int FindToken(const char* tokens, const char* keyword,
+                        size_t length) {
+  return (length == 0) ? -1
+         : (keyword[length - 1] == '#')
+           ? Match(tokens, keyword, length - 1, true, 0)
+           : First(Match(tokens, keyword, length, false, 0),
+                   Match(tokens, keyword, StripDigits(keyword, length),
+                         true, 0));
+}
+
+// ## Hashes ##
+
+//hash(i) = hash(i - 1) * magic_number + token
+constexpr scpi_hash_t Step(scpi_hash_t code, scpi_hash_t magic_number,
+                           unsigned long long token) {
+  return scpi_hash_t((unsigned long long)code * magic_number + token);
+}
+
+//Number of keywords in a command
+constexpr size_t CountKeywords(const char* command) {
+  return (*command == '\0') ? 0
+         : (*command == ':') ? CountKeywords(command + 1)
+         : 1 + CountKeywords(command + Length(command));
+}
+
+//Hashing step of a keyword, a query adds an extra step
+constexpr scpi_hash_t KeywordCode(int token, bool is_query, scpi_hash_t code,
+                                  scpi_hash_t magic_number) {
+  return (token < 0) ? UnknownTokenInCommand()
+         : is_query ? Step(Step(code, magic_number, token), magic_number, 0) - 1
+         : Step(code, magic_number, token);
+}
+
+//Hash of the keywords starting at command
+constexpr scpi_hash_t Hash(const char* tokens, const char* command,
+                           scpi_hash_t code, scpi_hash_t magic_number);
+
+//Hash of a keyword of the given length and the following ones
+constexpr scpi_hash_t HashKeyword(const char* tokens, const char* command,
+                                  size_t length, bool is_query,
+                                  scpi_hash_t code, scpi_hash_t magic_number) {
+  return Hash(tokens, command + length,
+              KeywordCode(FindToken(tokens, command,
+                                    is_query ? length - 1 : length),
+                          is_query, code, magic_number),
+              magic_number);
+}
+
+constexpr scpi_hash_t Hash(const char* tokens, const char* command,
+                           scpi_hash_t code, scpi_hash_t magic_number) {
+  return (*command == ':') ? Hash(tokens, command + 1, code, magic_number)
+         : (*command == '\0') ? code
+         : HashKeyword(tokens, command, Length(command),
+                       (command[Length(command)] == '\0')
+                       and (command[Length(command) - 1] == '?'),
+                       code, magic_number);
+}
+
+//Hash of a command, checking its size and the reserved hashes
+constexpr scpi_hash_t CheckReserved(scpi_hash_t code) {
+  return ((code == 0) or (code == 1)) ? ReservedHashInCommand() : code;
+}
+
+constexpr scpi_hash_t CommandCode(const char* tokens, const char* command,
+                                  scpi_hash_t magic_number,
+                                  scpi_hash_t magic_offset) {
+  return ((CountKeywords(command) == 0)
+          or (CountKeywords(command) > SCPI_MAX_COMMAND_DEPTH))
+         ? InvalidCommandSize()
+         : CheckReserved(Hash(tokens, command, magic_offset, magic_number));
+}
+
+// ## Sorting ##
+
+template <size_t... I>
+struct IndexSequence {};
+
+template <size_t N, size_t... I>
+struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, I...> {};
+
+template <size_t... I>
+struct MakeIndexSequence<0, I...> {
+  typedef IndexSequence<I...> type;
+};
+
+template <size_t N>
+struct Values {
+  scpi_hash_t codes[N];
+  uint8_t indexes[N];
+};
+
+//Position of the code i in the sorted table (stable)
+template <size_t N>
+constexpr uint8_t Rank(const Values<N>& values, size_t i,
+                       size_t low, size_t high) {
+  return (high - low == 1)
+         ? ( (values.codes[low] < values.codes[i])
+             or ((values.codes[low] == values.codes[i]) and (low < i)) )
+         : Rank(values, i, low, (low + high) / 2)
+           + Rank(values, i, (low + high) / 2, high);
+}
+
+//Index of the code at a position of the sorted table
+template <size_t N>
+constexpr uint8_t Find(const Values<N>& ranks, size_t position,
+                       size_t low, size_t high) {
+  return (high - low == 1)
+         ? ((ranks.indexes[low] == position) ? low : 0)
+         : Find(ranks, position, low, (low + high) / 2)
+           + Find(ranks, position, (low + high) / 2, high);
+}
+
+//Code at a position of the sorted table, checking for hash crashes
+template <size_t N>
+constexpr scpi_hash_t SortedCode(const Values<N>& values,
+                                 const Values<N>& order, size_t position) {
+  return ( (position > 0)
+           and (values.codes[order.indexes[position]]
+                == values.codes[order.indexes[position - 1]]) )
+         ? HashCrashInCommandTable() : values.codes[order.indexes[position]];
+}
+
+template <size_t N, size_t... I>
+constexpr Values<N> HashAll(const char* tokens,
+                            const SCPI_Const_Command (&commands)[N],
+                            scpi_hash_t magic_number, scpi_hash_t magic_offset,
+                            IndexSequence<I...>) {
+  return Values<N>{{CommandCode(tokens, commands[I].command,
+                                magic_number, magic_offset)...}, {}};
+}
+
+template <size_t N, size_t... I>
+constexpr Values<N> RankAll(const Values<N>& values, IndexSequence<I...>) {
+  return Values<N>{{}, {Rank(values, I, 0, N)...}};
+}
+
+template <size_t N, size_t... I>
+constexpr Values<N> OrderAll(const Values<N>& ranks, IndexSequence<I...>) {
+  return Values<N>{{}, {Find(ranks, I, 0, N)...}};
+}
+
+template <size_t N, size_t... I>
+constexpr SCPI_Const_Table<N> Build(const SCPI_Const_Table_Header& header,
+                                    const SCPI_Const_Command (&commands)[N],
+                                    const Values<N>& values,
+                                    const Values<N>& order,
+                                    IndexSequence<I...>) {
+  return SCPI_Const_Table<N>{header,
+                             {SortedCode(values, order, I)...},
+                             {commands[order.indexes[I]].caller...}};
+}
+
+template <size_t N>
+constexpr SCPI_Const_Table<N> Sort(const SCPI_Const_Table_Header& header,
+                                   const SCPI_Const_Command (&commands)[N],
+                                   const Values<N>& values) {
+  return Build(header, commands, values,
+               OrderAll(RankAll(values,
+                                typename MakeIndexSequence<N>::type()),
+                        typename MakeIndexSequence<N>::type()),
+               typename MakeIndexSequence<N>::type());
+}
+
+} // namespace scpi_const_table
+
+/*!
+ Builds a compile time command table.
+ @param tokens  Colon separated list of tokens, stored in flash (PROGMEM).
+        The tokens use the RegisterCommand format, e.g. ``"CHANnel#"``.
+ @param commands  Commands and their procedures.
+ @param magic_number  Magic number used for hashing the commands.
+ @param magic_offset  Magic offset used for hashing the commands.
+ @return the table, to be stored in a ``constexpr`` variable (PROGMEM).
+
+ The commands' hashes are calculated and sorted by the compiler.
+ Unknown tokens, commands deeper than SCPI_MAX_COMMAND_DEPTH keywords and
+ hash crashes are compile errors.
+ @see SCPI_Parser::SetCommandTable
+*/
+template <size_t N>
+constexpr SCPI_Const_Table<N> SCPI_MakeConstTable(
+    const char* tokens, const SCPI_Const_Command (&commands)[N],
+    scpi_hash_t magic_number = 37, scpi_hash_t magic_offset = 7) {
+  static_assert(N < 255, "Too many commands in a SCPI_Const_Table");
+  return scpi_const_table::Sort(
+    SCPI_Const_Table_Header{tokens, magic_number, magic_offset}, commands,
+    scpi_const_table::HashAll(tokens, commands, magic_number, magic_offset,
+      typename scpi_const_table::MakeIndexSequence<N>::type()));
+}
+
+#endif //VREKRER_SCPI_CONST_TABLE_H_
@@ -9,11 +9,21 @@ Header file.
 #define VREKRER_SCPI_VERSION "v0.5.0"
 
 
-/// Max branch size of the command tree and max number of parameters.
+/// Default of SCPI_MAX_COMMAND_DEPTH and SCPI_MAX_PARAMETERS.
 #ifndef SCPI_ARRAY_SYZE
   #define SCPI_ARRAY_SYZE 6
 #endif
 
+/// Max branch size of the command tree (keywords of a command).
+#ifndef SCPI_MAX_COMMAND_DEPTH
+  #define SCPI_MAX_COMMAND_DEPTH SCPI_ARRAY_SYZE
+#endif
+
+/// Max number of parameters of a command.
+#ifndef SCPI_MAX_PARAMETERS
+  #define SCPI_MAX_PARAMETERS SCPI_ARRAY_SYZE
+#endif
+
 /// Max number of valid tokens.
 #ifndef SCPI_MAX_TOKENS
   #define SCPI_MAX_TOKENS 15
@@ -29,16 +39,101 @@ Header file.
   #define SCPI_MAX_SPECIAL_COMMANDS 0
 #endif
 
+/// Length of the tokens' storage (chars of all the tokens, plus one per token).
+#ifndef SCPI_TOKEN_BUFFER_LENGTH
+  #define SCPI_TOKEN_BUFFER_LENGTH (SCPI_MAX_TOKENS * 10)
+#endif
+
 /// Length of the message buffer.
 #ifndef SCPI_BUFFER_LENGTH
   #define SCPI_BUFFER_LENGTH 64
 #endif
 
+/// Length of the receive buffer (0 reads the interface char by char).
+#ifndef SCPI_RECEIVE_BUFFER_LENGTH
+  #define SCPI_RECEIVE_BUFFER_LENGTH 0
+#endif
+
+/// Length of the response buffer (0 writes directly to the interface).
+#ifndef SCPI_RESPONSE_BUFFER_LENGTH
+  #define SCPI_RESPONSE_BUFFER_LENGTH 0
+#endif
+
+/// Enables IEEE 488.2 arbitrary block parameters (#<n><length><data>, #0).
+#ifndef SCPI_BLOCK_DATA
+  #define SCPI_BLOCK_DATA 0
+#endif
+
+/// Max number of pending overlapped operations (enables *OPC, *OPC? and *WAI).
+#ifndef SCPI_MAX_OPERATIONS
+  #define SCPI_MAX_OPERATIONS 0
+#endif
+
+/// Length of the queue for the messages received while waiting (*WAI, *OPC?).
+#ifndef SCPI_WAIT_QUEUE_LENGTH
+  #define SCPI_WAIT_QUEUE_LENGTH SCPI_BUFFER_LENGTH
+#endif
+
+/// Max number of pending streamed responses (enables StreamResponse).
+#ifndef SCPI_MAX_STREAMS
+  #define SCPI_MAX_STREAMS 0
+#endif
+
+/// Max number of chars requested to a stream producer on each call.
+#ifndef SCPI_STREAM_CHUNK_LENGTH
+  #define SCPI_STREAM_CHUNK_LENGTH 32
+#endif
+
+/// Enables procedures with a user context (SCPI_context_caller_t).
+#ifndef SCPI_HANDLER_CONTEXT
+  #define SCPI_HANDLER_CONTEXT 0
+#endif
+
+/// Number of entries of the SCPI error queue (0 disables the queue).
+#ifndef SCPI_ERROR_QUEUE_LENGTH
+  #define SCPI_ERROR_QUEUE_LENGTH 0
+#endif
+
+/// Max length of the context stored with each queued error (0 for none).
+#ifndef SCPI_ERROR_CONTEXT_LENGTH
+  #define SCPI_ERROR_CONTEXT_LENGTH 0
+#endif
+
+/// Enables the runtime statistics (calls, times, errors and high-water marks).
+#ifndef SCPI_STATISTICS
+  #define SCPI_STATISTICS 0
+#endif
+
+/// Number of entries of the header cache (0 disables the cache).
+#ifndef SCPI_HEADER_CACHE
+  #define SCPI_HEADER_CACHE 0
+#endif
+
+/// Max length of the headers stored in the header cache.
+#ifndef SCPI_HEADER_CACHE_KEY_LENGTH
+  #define SCPI_HEADER_CACHE_KEY_LENGTH 16
+#endif
+
 /// Integer size used for hashes.
 #ifndef SCPI_HASH_TYPE
   #define SCPI_HASH_TYPE uint8_t
 #endif
 
+/// Enables SCPI_Parser::FixHashCrashes (stores the commands' tokens).
+#ifndef SCPI_HASH_SEARCH
+  #define SCPI_HASH_SEARCH 0
+#endif
+
+/// Enables SCPI_Parser::SetCommandTable (compile time command tables).
+#ifndef SCPI_CONST_TABLE
+  #define SCPI_CONST_TABLE 0
+#endif
+
+/// Enables optional nodes in the registered commands, e.g. "MEASure[:DC]?".
+#ifndef SCPI_OPTIONAL_NODES
+  #define SCPI_OPTIONAL_NODES 0
+#endif
+
 #include "Arduino.h"
 
 /*!
@@ -52,8 +147,11 @@ Header file.
   \li \c Last()  : Returns the last value appended to the array.
   \li Indexing (e.g. \c my_array[1] to get the second value of the array).
 
- The max size of the array is defined by \c SCPI_ARRAY_SYZE (default 6).
+ The max size of the array is the template parameter \c N
+ (\c SCPI_MAX_COMMAND_DEPTH for SCPI_Commands and \c SCPI_MAX_PARAMETERS for
+ SCPI_Parameters).
 */
+template <uint8_t N>
 class SCPI_String_Array {
  public:
   char* operator[](const byte index) const;  //Add indexing capability
@@ -63,38 +161,58 @@ class SCPI_String_Array {
   char* Last() const;                        //Returns the last element of the array
   uint8_t Size() const;                      //Array size
   bool overflow_error = false;         //Storage overflow error
-  const uint8_t storage_size = SCPI_ARRAY_SYZE; //Max size of the array 
+  static const uint8_t storage_size = N; //Max size of the array 
  protected:
   uint8_t size_ = 0;              //Internal array size
-  char* values_[SCPI_ARRAY_SYZE]; //Storage of the strings
+  char* values_[N];               //Storage of the strings
 };
 
 /*!
  String array class used to store the tokens of a command.
  @see SCPI_String_Array
 */
-class SCPI_Commands : public SCPI_String_Array {
+class SCPI_Commands : public SCPI_String_Array<SCPI_MAX_COMMAND_DEPTH> {
  public:
   //Dummy constructor.
   SCPI_Commands();
   //Constructor that extracts and tokenize a command from a message
   SCPI_Commands(char* message);
   ///Not processed part of the message after the constructor is called.
-  char* not_processed_message;
+  char* not_processed_message = NULL;
+  //Numeric suffix of a level of the command path (0 if it has none)
+  uint16_t Suffix(uint8_t level) const;
+ protected:
+  template <class Config> friend class SCPI_Basic_Parser;
+  //Split the header in tokens, return the char that ends it
+  char* Tokenize_(char* message);
+  //Numeric suffixes of the command path, set by the parser
+  uint16_t suffixes_[SCPI_MAX_COMMAND_DEPTH] = {};
+  #if SCPI_OPTIONAL_NODES
+  //Keywords of the header path, without the skipped optional nodes
+  uint8_t path_depth_ = 0;
+  //Keywords with an optional node token (bit i for the keyword i)
+  uint32_t optional_keywords_ = 0;
+  //Tokens of the keywords, set by the parser
+  uint8_t tokens_[SCPI_MAX_COMMAND_DEPTH] = {};
+  #endif
 };
 
 /*!
  String array class used to store the parameters found after a command.
  @see SCPI_String_Array
 */
-class SCPI_Parameters : public SCPI_String_Array {
+class SCPI_Parameters : public SCPI_String_Array<SCPI_MAX_PARAMETERS> {
  public:
   //Dummy constructor.
   SCPI_Parameters();
   //Constructor that extracts and splits parameters from a message
   SCPI_Parameters(char *message);
   ///Not processed part of the message after the constructor is called.
-  char* not_processed_message;
+  char* not_processed_message = NULL;
+ protected:
+  template <class Config> friend class SCPI_Basic_Parser;
+  //Split the parameters, return the message after the ';' (or NULL)
+  char* Split_(char* message);
 };
 
 ///Alias of SCPI_Commands.
@@ -107,17 +225,200 @@ using SCPI_P = SCPI_Parameters;
 using SCPI_caller_t = void(*)(SCPI_Commands, SCPI_Parameters, Stream&);
 ///Void template used with SCPI_Parser::RegisterSpecialCommand.
 using SCPI_special_caller_t = void(*)(SCPI_Commands, Stream&);
+///Template used with SCPI_Parser::RegisterCommand for procedures with a 
+///context (the commands and parameters are not copied).
+using SCPI_context_caller_t = void(*)(const SCPI_Commands&, 
+                                      const SCPI_Parameters&, Stream&, void*);
+///Template used with SCPI_Parser::StartOperation (true when completed).
+using SCPI_operation_t = bool(*)();
+///Template used with SCPI_Parser::StreamResponse, copies up to size chars of
+///the response, from position, to buffer (returns the number of chars).
+using SCPI_producer_t = size_t(*)(char* buffer, size_t size, 
+                                  uint32_t position);
+
+/*!
+ SCPI_context_caller_t procedure that calls a member function, the context 
+ is the object.
+
+ Example:  
+  ``my_instrument.RegisterCommand(F("OUTPut"),``  
+  ``    &SCPI_Method<PowerSupply, &PowerSupply::SetOutput>, &supply);``
+*/
+template <class T, void (T::*Method)(const SCPI_Commands&, 
+                                     const SCPI_Parameters&, Stream&)>
+void SCPI_Method(const SCPI_Commands& commands, 
+                 const SCPI_Parameters& parameters, Stream& interface, 
+                 void* object) {
+  (static_cast<T*>(object)->*Method)(commands, parameters, interface);
+}
 
 /// Integer size used for hashes.
 using scpi_hash_t = SCPI_HASH_TYPE;
 
+/// Integer size used for message lengths.
+#if SCPI_BUFFER_LENGTH > 255
+using scpi_length_t = uint16_t;
+#else
+using scpi_length_t = uint8_t;
+#endif
+
+/*!
+ Command definition used with SCPI_Parser::RegisterCommands and
+ SCPI_MakeConstTable.
+*/
+struct SCPI_Const_Command {
+  ///Command, e.g. ``"SYSTem:ERRor?"``
+  const char* command;
+  ///Procedure associated to the command
+  SCPI_caller_t caller;
+};
+
+#if SCPI_CONST_TABLE
+#include "Vrekrer_scpi_const_table.h"
+#endif
+
+/*!
+  Receive state of a communication link, without the message buffer.
+  @see SCPI_Basic_Session
+*/
+class SCPI_Session_State {
+ protected:
+  template <class Config> friend class SCPI_Basic_Parser;
+  friend class SCPI_Input_Stream;
+  friend class SCPI_Block_Stream;
+  //Length of the readed message
+  scpi_length_t message_length_ = 0;
+  //Varible used for checking timeout errors
+  unsigned long time_checker_;
+  #if SCPI_MAX_SPECIAL_COMMANDS
+  //The first space of the message was received
+  bool message_has_space_ = false;
+  #endif
+
+  #if SCPI_RECEIVE_BUFFER_LENGTH or SCPI_BLOCK_DATA
+  //Number of received chars (receive buffer and interface)
+  int AvailableInput_(Stream& interface);
+  //Read a received char (receive buffer first)
+  int ReadInput_(Stream& interface);
+  //Peek a received char (receive buffer first)
+  int PeekInput_(Stream& interface);
+  #endif
+
+  #if SCPI_BLOCK_DATA
+  //Track the message syntax, return true after a block header (#<n><length>)
+  bool ScanBlockHeader_(char new_char);
+  //Start of the current message unit in msg_buffer_
+  scpi_length_t unit_start_ = 0;
+  //Message unit syntax: 0 before, 1 in and 2 after the header
+  uint8_t unit_state_ = 0;
+  //Quote char of the current quoted string ('\0' if not in a string)
+  char quote_ = '\0';
+  //The next char starts a parameter
+  bool parameter_start_ = false;
+  //Block header: -2 none, -1 after '#', >0 length digits to be received
+  int8_t block_state_ = -2;
+  //Length of the received block header
+  uint32_t block_length_ = 0;
+  //A block was just read, its message unit separator is ignored
+  bool after_block_ = false;
+  #endif
+
+  #if SCPI_RECEIVE_BUFFER_LENGTH
+  //Length of the receive buffer.
+  static const uint16_t receive_buffer_length = SCPI_RECEIVE_BUFFER_LENGTH;
+  //Read the available chars of an interface into the receive buffer
+  bool ReceiveInput_(Stream& interface);
+  //Receive buffer (ring buffer) with the chars not processed yet
+  char receive_buffer_[SCPI_RECEIVE_BUFFER_LENGTH];
+  //Position of the first char in the receive buffer
+  uint16_t receive_start_ = 0;
+  //Number of chars in the receive buffer
+  uint16_t receive_size_ = 0;
+  #endif
+};
+
+/*!
+  Receive state of a communication link.
+
+  Holds the message buffer and the partially received message of an
+  interface. A SCPI_Parser can serve several interfaces (e.g. Serial and an
+  EthernetClient) using one SCPI_Session for each of them, all of them share
+  the parser's registered commands.  
+  The length of the message buffer is \c N, the \c buffer_length of the 
+  parser's configuration (see SCPI_Basic_Parser::session_t).
+*/
+template <scpi_length_t N>
+class SCPI_Basic_Session : public SCPI_Session_State {
+ protected:
+  template <class Config> friend class SCPI_Basic_Parser;
+  //Message buffer.
+  char msg_buffer_[N];
+};
+
+///Session of SCPI_Parser (SCPI_BUFFER_LENGTH message buffer).
+using SCPI_Session = SCPI_Basic_Session<SCPI_BUFFER_LENGTH>;
+
+/*!
+ Default sizes of SCPI_Parser (set with the SCPI_* macros).
+
+ Parsers with other sizes are declared with SCPI_Basic_Parser and a 
+ configuration derived from this one, e.g.  
+ ``struct Small_Config : SCPI_Parser_Config {``  
+ ``  static const uint8_t max_tokens = 8;``  
+ ``  static const uint16_t token_buffer_length = 64;``  
+ ``  static const uint8_t max_commands = 10;``  
+ ``  static const scpi_length_t buffer_length = 32;``  
+ ``  static const uint8_t max_command_depth = 3;``  
+ ``};``  
+ ``SCPI_Basic_Parser<Small_Config> small_instrument;``
+
+ The macros set the largest sizes: \c max_command_depth and 
+ \c max_parameters can not exceed SCPI_MAX_COMMAND_DEPTH and 
+ SCPI_MAX_PARAMETERS (the sizes of SCPI_Commands and SCPI_Parameters), and
+ a \c buffer_length over 255 needs a SCPI_BUFFER_LENGTH over 255.  
+ The sizes of the optional features are only used when the feature is 
+ enabled by its macro, they can not be 0 then.
+*/
+struct SCPI_Parser_Config {
+  ///Max number of valid tokens.
+  static const uint8_t max_tokens = SCPI_MAX_TOKENS;
+  ///Length of the tokens' storage.
+  static const uint16_t token_buffer_length = SCPI_TOKEN_BUFFER_LENGTH;
+  ///Max number of registered commands.
+  static const uint8_t max_commands = SCPI_MAX_COMMANDS;
+  ///Integer size used for hashes.
+  using hash_type = SCPI_HASH_TYPE;
+  ///Length of the message buffer.
+  static const scpi_length_t buffer_length = SCPI_BUFFER_LENGTH;
+  ///Max number of keywords of the registered commands.
+  static const uint8_t max_command_depth = SCPI_MAX_COMMAND_DEPTH;
+  ///Max number of parameters, the next ones are ignored.
+  static const uint8_t max_parameters = SCPI_MAX_PARAMETERS;
+  ///Max number of pending overlapped operations.
+  static const uint8_t max_operations = SCPI_MAX_OPERATIONS;
+  ///Length of the queue for the messages received while waiting.
+  static const uint16_t wait_queue_length = SCPI_WAIT_QUEUE_LENGTH;
+  ///Max number of pending streamed responses.
+  static const uint8_t max_streams = SCPI_MAX_STREAMS;
+  ///Max number of registered special commands.
+  static const uint8_t max_special_commands = SCPI_MAX_SPECIAL_COMMANDS;
+};
+
 /*!
   Main class of the Vrekrer_SCPI_Parser library.
+
+  The storage of the tokens and commands is sized by \c Config at compile 
+  time (see SCPI_Parser_Config). SCPI_Parser uses the default sizes.
 */
-class SCPI_Parser {
+template <class Config>
+class SCPI_Basic_Parser {
  public:
+  ///Integer size used for hashes.
+  using hash_t = typename Config::hash_type;
+  ///Session (receive state of an interface) used with this parser.
+  using session_t = SCPI_Basic_Session<Config::buffer_length>;
   //Constructor
-  SCPI_Parser();
+  SCPI_Basic_Parser();
   //Change the TreeBase for the next RegisterCommand calls
   void SetCommandTreeBase(char* tree_base);
   //SetCommandTreeBase version with RAM string support
@@ -131,8 +432,32 @@ class SCPI_Parser {
   //RegisterCommand version with Flash strings (F() macro) support
   void RegisterCommand(const __FlashStringHelper* command,
                        SCPI_caller_t caller);
+  //Registers the commands of an array stored in flash (PROGMEM)
+  void RegisterCommands(const SCPI_Const_Command* commands, uint8_t size);
+  ///RegisterCommands version for arrays.
+  template <size_t N>
+  void RegisterCommands(const SCPI_Const_Command (&commands)[N]) {
+    this->RegisterCommands(commands, N);
+  }
+  #if SCPI_HANDLER_CONTEXT
+  //RegisterCommand version for procedures with a context (e.g. an object)
+  void RegisterCommand(char* command, SCPI_context_caller_t caller,
+                       void* context);
+  //RegisterCommand version with a context and RAM string support
+  void RegisterCommand(const char* command, SCPI_context_caller_t caller,
+                       void* context);
+  //RegisterCommand version with a context and Flash strings support
+  void RegisterCommand(const __FlashStringHelper* command,
+                       SCPI_context_caller_t caller, void* context);
+  #endif
   //Set the function to be used by the error handler.
   void SetErrorHandler(SCPI_caller_t caller);
+  #if SCPI_HANDLER_CONTEXT
+  //SetErrorHandler version for a procedure with a context
+  void SetErrorHandler(SCPI_context_caller_t caller, void* context);
+  #endif
+  //Makes the registered commands read only (allows concurrent Execute calls)
+  void Freeze();
   ///SCPI Error codes.
   enum class ErrorCode{
     ///No error
@@ -143,23 +468,150 @@ class SCPI_Parser {
     Timeout,
     ///Message buffer overflow.
     BufferOverflow,
+    ///Missing parameter.
+    MissingParameter,
+    ///Invalid parameter (wrong data type or syntax).
+    InvalidParameter,
+    ///Parameter out of the allowed range.
+    OutOfRange,
+    ///Streamed response interrupted by a new message.
+    QueryInterrupted,
+    ///Overlapped operation not started, too many pending operations.
+    OperationIgnored,
   };
   ///Variable that holds the last error code.
   ErrorCode last_error = ErrorCode::NoError;
+  #if SCPI_ERROR_QUEUE_LENGTH
+  //Add an error to the error queue (e.g. a device-specific error)
+  void PushError(int16_t code, const char* context = NULL);
+  //Remove the oldest error from the queue and print it (SCPI format)
+  void PrintNextError(Stream& interface);
+  //Empty the error queue (e.g. from the *CLS procedure)
+  void ClearErrors();
+  ///Number of errors in the error queue.
+  uint8_t ErrorCount() { return error_queue_size_; }
+  #endif
+  #if SCPI_STATISTICS
+  ///Runtime statistics of a registered command.
+  struct command_statistics {
+    ///Number of calls.
+    uint32_t calls;
+    ///Total execution time of the procedure, in microseconds.
+    uint32_t total_time;
+    ///Longest execution time of the procedure, in microseconds.
+    uint32_t max_time;
+    ///Total time used to parse and find the command, in microseconds.
+    uint32_t parse_time;
+    ///Longest time used to parse and find the command, in microseconds.
+    uint32_t max_parse_time;
+  };
+  ///Runtime statistics of the parser.
+  struct parser_statistics {
+    ///Number of executed message units.
+    uint32_t units;
+    ///Total time used to parse and find the commands of all the message
+    ///units, in microseconds (see also command_statistics::parse_time).
+    uint32_t parse_time;
+    ///Longest time used to parse and find a command, in microseconds.
+    uint32_t max_parse_time;
+    ///Number of errors, indexed by ErrorCode.
+    uint32_t errors[uint8_t(ErrorCode::OperationIgnored) + 1];
+    ///Longest received message (high-water mark of the message buffer).
+    scpi_length_t max_message_length;
+    ///Max number of parameters of a message unit.
+    uint8_t max_parameters;
+  };
+  ///Runtime statistics, see PrintStatistics.
+  parser_statistics statistics;
+  //Get the statistics of a registered command
+  bool GetCommandStatistics(const char* command, 
+                            command_statistics& command_stats);
+  //Clear the runtime statistics
+  void ResetStatistics();
+  //Prints the runtime statistics to an interface
+  void PrintStatistics(Stream& interface);
+  //Prints the runtime statistics as a list of numbers (for a query)
+  void PrintStatisticsList(Stream& interface);
+  #endif
   //Process a message and execute it a valid command is found
   void Execute(char* message, Stream& interface);
   //Gets a message from a Stream interface and execute it
   void ProcessInput(Stream& interface, const char* term_chars);
+  //ProcessInput version for a SCPI_Session (one for each interface)
+  void ProcessInput(session_t& session, Stream& interface, 
+                    const char* term_chars);
+  //Gets and executes all the complete messages available in an interface
+  void ProcessAllInput(Stream& interface, const char* term_chars);
+  //ProcessAllInput version for a SCPI_Session (one for each interface)
+  void ProcessAllInput(session_t& session, Stream& interface, 
+                       const char* term_chars);
+  //Process received data (e.g. a DMA buffer), executing complete messages
+  void Feed(const char* data, size_t length, Stream& interface,
+            const char* term_chars, unsigned long timestamp = millis());
+  //Feed version for a SCPI_Session (one for each interface)
+  void Feed(session_t& session, const char* data, size_t length,
+            Stream& interface, const char* term_chars,
+            unsigned long timestamp = millis());
   //Gets a message from a Stream interface
   char* GetMessage(Stream& interface, const char* term_chars);
+  //GetMessage version for a SCPI_Session (one for each interface)
+  char* GetMessage(session_t& session, Stream& interface, 
+                   const char* term_chars);
   //Prints registered tokens and command hashes to the serial interface
   void PrintDebugInfo(Stream& interface);
+  #if SCPI_HEADER_CACHE
+  ///Number of headers found in the header cache.
+  uint32_t header_cache_hits = 0;
+  ///Number of headers not found in the header cache.
+  uint32_t header_cache_misses = 0;
+  #endif
+  #if SCPI_MAX_OPERATIONS
+  //Start an overlapped operation, it is polled until it completes
+  bool StartOperation(SCPI_operation_t operation);
+  //Poll the pending operations, true if all of them are completed
+  bool PollOperations();
+  ///Set when all the operations are completed after a *OPC (ESR OPC bit).
+  bool operation_complete = false;
+  #endif
+  #if SCPI_MAX_STREAMS
+  //Start a response that is written as the interface accepts the data
+  bool StreamResponse(Stream& interface, SCPI_producer_t producer,
+                      uint32_t length, bool block = false);
+  //Write the pending streamed responses, true if all of them are completed
+  bool PollResponses();
+  #endif
+  //Decode an integer parameter (also MINimum, MAXimum and DEFault)
+  bool GetInteger(const SCPI_P& parameters, uint8_t index, long& value,
+                  long min_value, long max_value, Stream& interface);
+  //Decode a real parameter with optional unit (also MIN, MAX and DEF)
+  bool GetReal(const SCPI_P& parameters, uint8_t index, float& value,
+               float min_value, float max_value, const char* unit,
+               Stream& interface);
+  //Decode a boolean parameter (ON, OFF or a number)
+  bool GetBoolean(const SCPI_P& parameters, uint8_t index, bool& value,
+                  Stream& interface);
+  //Decode a parameter from a list of choices (e.g. "BUS|IMMediate")
+  bool GetChoice(const SCPI_P& parameters, uint8_t index, 
+                 const char* choices, uint8_t& value, Stream& interface);
   ///Magic number used for hashing the commands
-  scpi_hash_t hash_magic_number = 37;
+  hash_t hash_magic_number = 37;
   ///Magic offset used for hashing the commands
-  scpi_hash_t hash_magic_offset = 7;
+  hash_t hash_magic_offset = 7;
   //Timeout, in miliseconds, for GetMessage and ProcessInput.
   unsigned long timeout = 10;
+
+  #if SCPI_HASH_SEARCH
+  //Search hash magic numbers without crashes for the registered commands
+  bool FixHashCrashes();
+  #endif
+
+  #if SCPI_CONST_TABLE
+  ///Use a compile time command table (see SCPI_MakeConstTable).
+  template <size_t N>
+  void SetCommandTable(const SCPI_Const_Table<N>& table) {
+    this->SetCommandTable_(&table.header, table.codes, table.callers, N);
+  }
+  #endif
   
   #if SCPI_MAX_SPECIAL_COMMANDS
   //Registers a new valid special command and associate a procedure to it
@@ -174,64 +626,535 @@ class SCPI_Parser {
 
  protected:
   //Length of the message buffer.
-  const uint8_t buffer_length = SCPI_BUFFER_LENGTH;
+  static const scpi_length_t buffer_length = Config::buffer_length;
+  //Max number of keywords of the registered commands.
+  static const uint8_t max_command_depth = Config::max_command_depth;
+  //Max number of parameters.
+  static const uint8_t max_parameters = Config::max_parameters;
+  static_assert((max_command_depth > 0) 
+                and (max_command_depth <= SCPI_MAX_COMMAND_DEPTH),
+                "max_command_depth must be 1 to SCPI_MAX_COMMAND_DEPTH");
+  static_assert(max_parameters <= SCPI_MAX_PARAMETERS,
+                "max_parameters can not exceed SCPI_MAX_PARAMETERS");
   //Max number of valid tokens.
-  const uint8_t max_tokens = SCPI_MAX_TOKENS;
+  static const uint8_t max_tokens = Config::max_tokens;
+  //Length of the tokens' storage.
+  static const uint16_t token_buffer_length = Config::token_buffer_length;
   //Max number of registered commands.
-  const uint8_t max_commands = SCPI_MAX_COMMANDS;
+  static const uint8_t max_commands = Config::max_commands;
   //Internal errors container
   struct internal_errors {
     //Command storage overflow error
     bool command_overflow = false;
     //Token storage overflow error
     bool token_overflow = false;
+    //Tokens' text storage overflow error
+    bool token_buffer_overflow = false;
     //Branch (SCPI_Commands) storage overflow error
     bool branch_overflow = false;
     //Special command storage overflow error
     bool special_command_overflow = false;
+    //Two registered commands have the same hash
+    bool hash_crash = false;
   } setup_errors;
   //Hash result for unknown commands
-  const scpi_hash_t unknown_hash = 0;
+  const hash_t unknown_hash = 0;
   //Hash reserved for invalid commands
-  const scpi_hash_t invalid_hash = 1;
+  const hash_t invalid_hash = 1;
+
+  //Header path of the message units of a program message (IEEE 488.2)
+  struct header_path {
+    //Hash of the path (0 for root)
+    hash_t code = 0;
+    //Number of keywords of the path
+    uint8_t depth = 0;
+    //Numeric suffixes of the keywords of the path
+    uint16_t suffixes[Config::max_command_depth];
+  };
+
+  //Valid keyword (short or long form of a token)
+  struct keyword_entry {
+    //Index of the token
+    uint8_t token;
+    //Length of the keyword
+    uint8_t length;
+    //The token accepts numeric suffixes
+    bool numeric_suffix;
+  };
+
+  //Decode a number, its value is mantissa * 10^exponent
+  static bool DecodeNumber_(const char* text, const char* unit,
+                            uint32_t& mantissa, int16_t& exponent,
+                            bool& negative);
+  //Compare a parameter with a keyword (short or long form)
+  static bool MatchParameterKeyword_(const char* text, const char* keyword);
+  //Get the text of a parameter, report missing parameters
+  char* GetParameter_(const SCPI_P& parameters, uint8_t index, 
+                      Stream& interface);
+  //Report a parameter error, always return false
+  bool ParameterError_(ErrorCode error, const SCPI_P& parameters, 
+                       Stream& interface, const char* context = NULL);
+  //Set last_error (and count it and queue it)
+  void SetError_(ErrorCode error, const char* context = NULL, 
+                 const char* context_end = NULL);
+  //Call the procedure of a command (index as returned by FindCaller_)
+  void Call_(uint8_t index, SCPI_caller_t caller, const SCPI_C& commands,
+             const SCPI_P& parameters, Stream& interface);
+  //Call the ErrorHandler (and update its statistics)
+  void CallErrorHandler_(Stream& interface, 
+                         const SCPI_P& parameters = SCPI_P());
+  //Execute the message units of a message, starting at a header path
+  void Execute_(char* message, Stream& interface, header_path& path);
+  //Add a command's hash, return its position (max_commands on errors)
+  uint8_t AddCommand_(char* command);
+  #if SCPI_STATISTICS
+  //Call a procedure and update its statistics
+  void CallMeasured_(uint8_t index, SCPI_caller_t caller, SCPI_C& commands,
+                     SCPI_P& parameters, Stream& interface, 
+                     unsigned long unit_start);
+  //Statistics of the registered commands (same order as valid_codes_), 
+  //the last one is the ErrorHandler
+  command_statistics command_stats_[Config::max_commands+1];
+  #endif
 
   //Add a token to the tokens' storage
   void AddToken_(char* token);
-  //Get a hash from a command
-  scpi_hash_t GetCommandCode_(SCPI_Commands& commands);
+  //Compare a keyword with a valid keyword entry
+  int CompareKeyword_(const char* keyword, uint8_t length,
+                      bool numeric_suffix, const keyword_entry& entry);
+  //Position of the first valid keyword not lower than a keyword
+  uint16_t LowerBoundKeyword_(const char* keyword, uint8_t length,
+                              bool numeric_suffix);
+  //Insert a valid keyword keeping the keywords sorted
+  void InsertKeyword_(uint8_t token, uint8_t length, bool numeric_suffix);
+  //Get the token index of a valid keyword (-1 if not valid)
+  int MatchKeyword_(const char* keyword, uint8_t length, bool numeric_suffix);
+  //Get the token index that matches a command keyword (-1 if not found)
+  int FindToken_(const char* keyword, size_t length, 
+                 uint16_t* suffix = NULL);
+  //Get a hash from a command (including the TreeBase)
+  hash_t GetCommandCode_(SCPI_Commands& commands);
+  //Get a hash from a command, starting at a branch (0 for root)
+  hash_t GetCommandCode_(SCPI_Commands& commands, hash_t tree_code,
+                              hash_t* branch_code = NULL, 
+                              uint32_t skip = 0);
+  //Get the index of a registered command (max_commands if not found)
+  uint8_t FindCommand_(hash_t code);
+  //Get the caller of a hash (index max_commands if not found)
+  uint8_t FindCaller_(hash_t code, SCPI_caller_t& caller);
+  //Get the caller of a command, starting at a branch (0 for root)
+  uint8_t FindBranchCaller_(SCPI_Commands& commands, hash_t tree_code,
+                            hash_t& branch_code, SCPI_caller_t& caller);
+  //Get the caller of a message unit header, following the header path
+  uint8_t FindHeaderCaller_(SCPI_Commands& commands, const char* header_end,
+                            bool absolute, header_path& path,
+                            SCPI_caller_t& caller);
+  //Test if a hash is allready used by a registered command
+  bool IsRegistered_(hash_t code);
   //Number of stored tokens
   uint8_t tokens_size_ = 0;
-  //Storage for tokens
-  char *tokens_[SCPI_MAX_TOKENS];
+  //Storage for tokens (upper case, without '?' and '#' symbols)
+  char *tokens_[Config::max_tokens];
+  //Tokens' text storage (null terminated tokens, used by tokens_)
+  char token_buffer_[Config::token_buffer_length];
+  //Used length of token_buffer_
+  uint16_t token_buffer_size_ = 0;
+  //Length of the tokens' short form
+  uint8_t tokens_short_length_[Config::max_tokens];
+  //Number of valid keywords
+  uint16_t keywords_size_ = 0;
+  //Valid keywords, sorted alphabetically (case folded)
+  keyword_entry keywords_[2*Config::max_tokens];
+  //Flag the token of the first keyword of a command (a root keyword)
+  void AddRootToken_(const char* keyword);
+  //Test if a keyword is the first keyword of a registered command
+  bool IsRootKeyword_(const char* keyword);
+  //Tokens of the root keywords (one bit per token)
+  uint8_t root_tokens_[(Config::max_tokens + 7) / 8] = {};
+  #if SCPI_OPTIONAL_NODES
+  //Remove the brackets of the optional nodes, flag the optional keywords
+  void StripOptionalNodes_(char* command, uint32_t& optional);
+  //Flag the tokens of the optional keywords of a command
+  void AddOptionalTokens_(SCPI_Commands& commands, uint32_t optional);
+  ///Test if a token was registered as an optional node.
+  bool IsOptionalToken_(int token) {
+    #if SCPI_CONST_TABLE
+    //Command tables do not have optional nodes, and their token indexes 
+    //are not bounded by max_tokens
+    if (table_tokens_ != NULL) return false;
+    #endif
+    if ((token < 0) or (token >= max_tokens)) return false;
+    return (optional_tokens_[token / 8] >> (token % 8)) & 1;
+  }
+  //Tokens registered as optional nodes (one bit per token)
+  uint8_t optional_tokens_[(Config::max_tokens + 7) / 8] = {};
+  //At least one token was registered as an optional node
+  bool has_optional_ = false;
+  //Set of tokens (one bit per token)
+  struct token_set {
+    uint8_t bits[(Config::max_tokens + 7) / 8];
+  };
+  //Add the tokens of some keywords of a command to a set
+  void AddKeywordTokens_(const SCPI_Commands& commands, uint32_t keywords,
+                         token_set& tokens);
+  //Test if the tokens of some keywords of a command are in a set
+  bool HasKeywordTokens_(const SCPI_Commands& commands, uint32_t keywords,
+                         const token_set& tokens);
+  //Tokens of the optional nodes of each command (same order as valid_codes_)
+  token_set command_optional_[Config::max_commands];
+  //Tokens of the optional nodes of the TreeBase
+  token_set tree_optional_ = {};
+  #endif
   //Number of registered commands
   uint8_t codes_size_ = 0;
-  //Registered commands' hash storage
-  scpi_hash_t valid_codes_[SCPI_MAX_COMMANDS];
+  //Registered commands' hash storage (sorted)
+  hash_t valid_codes_[Config::max_commands];
   //Pointers to the functions to be called when a valid command is received
-  SCPI_caller_t callers_[SCPI_MAX_COMMANDS+1];
+  //(same order as valid_codes_), the last one is the ErrorHandler
+  SCPI_caller_t callers_[Config::max_commands+1];
+  #if SCPI_HANDLER_CONTEXT
+  //Procedures with a context (same order as callers_, NULL if not used)
+  SCPI_context_caller_t context_callers_[Config::max_commands+1];
+  //Contexts of the context_callers_
+  void* contexts_[Config::max_commands+1];
+  #endif
   //TreeBase branch's hash used when calculating hashes (0 for root)
-  scpi_hash_t tree_code_ = 0;
+  hash_t tree_code_ = 0;
   //TreeBase branch's length (0 for root)
   uint8_t tree_length_ = 0;
-  //Message buffer.
-  char msg_buffer_[SCPI_BUFFER_LENGTH];
-  //Length of the readed message
-  uint8_t message_length_ = 0;
-  //Varible used for checking timeout errors
-  unsigned long time_checker_;
+  //The registered commands are read only (see Freeze)
+  bool frozen_ = false;
+  #if SCPI_HEADER_CACHE
+  //Header cache entry (direct mapped)
+  struct header_cache_entry {
+    //Header bytes, as split by SCPI_Commands (tokens separated by '\0')
+    char header[SCPI_HEADER_CACHE_KEY_LENGTH];
+    //Length of the header (0 for empty entries)
+    uint8_t length;
+    //Index of the command's caller (as returned by FindCaller_)
+    uint8_t index;
+    //Hash of the header path after the command
+    hash_t branch_code;
+    //Command's caller
+    SCPI_caller_t caller;
+    //Numeric suffixes of the keywords
+    uint16_t suffixes[Config::max_command_depth];
+    #if SCPI_OPTIONAL_NODES
+    //Keywords of the header path (SCPI_Commands::path_depth_)
+    uint8_t path_depth;
+    #endif
+  };
+  //Get the caller of a header from the root, using the cache
+  uint8_t GetCachedCommand_(SCPI_Commands& commands, const char* header_end,
+                            hash_t& branch_code, SCPI_caller_t& caller);
+  //Empty the header cache (the registered commands changed)
+  void ClearHeaderCache_();
+  //Header cache storage
+  header_cache_entry header_cache_[SCPI_HEADER_CACHE];
+  #endif
+  #if SCPI_HASH_SEARCH
+  //Tokens of a registered command, used to recalculate its hash
+  struct command_record {
+    //Token indexes (including the TreeBase ones)
+    uint8_t tokens[Config::max_command_depth];
+    //Number of tokens (0 for invalid commands)
+    uint8_t size;
+    //The command is a query
+    bool is_query;
+  };
+  //Store the tokens of a command (and the TreeBase)
+  void RecordCommand_(SCPI_Commands& commands, command_record& record,
+                      uint32_t skip = 0);
+  //Hash of a recorded command using the current magic numbers
+  hash_t RecordCode_(const command_record& record);
+  //Recalculate all hashes, return true if there are no hash crashes
+  bool TestHashParameters_(hash_t magic_number, hash_t magic_offset);
+  //Tokens of the TreeBase
+  command_record tree_record_ = {};
+  //Tokens of the registered commands (same order as valid_codes_)
+  command_record records_[Config::max_commands];
+  #endif
+
+  #if SCPI_CONST_TABLE
+  //Set the compile time command table (stored in flash)
+  void SetCommandTable_(const SCPI_Const_Table_Header* header,
+                        const hash_t* codes,
+                        const SCPI_caller_t* callers, uint8_t size);
+  //Get the token index of a keyword in the command table's tokens
+  int MatchTableKeyword_(const char* keyword, uint8_t length,
+                         bool numeric_suffix);
+  //Get the procedure of a command in the command table (NULL if not found)
+  SCPI_caller_t FindTableCaller_(hash_t code);
+  //Command table's tokens (NULL if no command table is used)
+  const char* table_tokens_ = NULL;
+  //Command table's hashes (sorted)
+  const hash_t* table_codes_ = NULL;
+  //Command table's procedures (same order as table_codes_)
+  const SCPI_caller_t* table_callers_ = NULL;
+  //Number of commands in the command table
+  uint8_t table_size_ = 0;
+  #endif
+
+  //Session used by the calls without a SCPI_Session (and as scratch buffer)
+  session_t session_;
+  #if SCPI_ERROR_QUEUE_LENGTH
+  //Error queue entry
+  struct error_entry {
+    //SCPI error code (e.g. -113)
+    int16_t code;
+    #if SCPI_ERROR_CONTEXT_LENGTH
+    //Context of the error (e.g. the header), null terminated
+    char context[SCPI_ERROR_CONTEXT_LENGTH + 1];
+    #endif
+  };
+  //SCPI error code of an ErrorCode
+  static int16_t ScpiErrorCode_(ErrorCode error);
+  //Add an error, the context ends at context_end ('\0' are printed as ':')
+  void PushError_(int16_t code, const char* context, const char* context_end);
+  //Error queue storage (ring buffer)
+  error_entry error_queue_[SCPI_ERROR_QUEUE_LENGTH];
+  //Position of the oldest error in error_queue_
+  uint8_t error_queue_start_ = 0;
+  //Number of errors in error_queue_
+  uint8_t error_queue_size_ = 0;
+  #endif
+  #if SCPI_MAX_OPERATIONS
+  //Max number of pending overlapped operations.
+  static const uint8_t max_operations = Config::max_operations;
+  //Length of the wait queue.
+  static const uint16_t wait_queue_length = Config::wait_queue_length;
+  static_assert((max_operations > 0) and (wait_queue_length > 0),
+                "max_operations and wait_queue_length can not be 0");
+  //Identify *OPC (1), *OPC? (2) and *WAI (3), 0 for other commands
+  uint8_t SyncCommand_(const char* header);
+  //Store a message until the pending operations are completed
+  bool QueueMessage_(const char* unit, const char* message, 
+                     Stream& interface, const header_path& path);
+  //Number of pending operations
+  uint8_t operations_size_ = 0;
+  //Polling procedures of the pending operations
+  SCPI_operation_t operations_[Config::max_operations];
+  //*OPC received, operation_complete is set when the operations complete
+  bool opc_armed_ = false;
+  //*WAI or *OPC? received, the new messages are queued
+  bool waiting_ = false;
+  //The queued messages are being executed
+  bool replaying_ = false;
+  //Messages received while waiting, [Stream*][header_path][message]['\0']
+  //entries
+  char wait_queue_[Config::wait_queue_length];
+  //Used length of wait_queue_
+  uint16_t wait_queue_size_ = 0;
+  #endif
+  #if SCPI_MAX_STREAMS
+  //Max number of pending streamed responses.
+  static const uint8_t max_streams = Config::max_streams;
+  static_assert(max_streams > 0, "max_streams can not be 0");
+  //Pending streamed response
+  struct stream_entry {
+    //Interface where the response is written
+    Stream* interface;
+    //Procedure that produces the data
+    SCPI_producer_t producer;
+    //Length of the data (0 if it ends when the producer returns 0)
+    uint32_t length;
+    //Chars of data already written
+    uint32_t position;
+    //Block header ("#<n><length>" or "#0"), empty if not a block
+    char header[12];
+    uint8_t header_length;
+    //Chars of the header already written
+    uint8_t header_sent;
+    //All the data was written, only the '\n' is pending
+    bool data_ended;
+    //The interface does not report its free space, it is written until
+    //the producer has no more data (with blocking writes)
+    bool blocking;
+  };
+  //Write a streamed response, up to the interface's availableForWrite
+  bool WriteResponse_(stream_entry& entry);
+  //There is a pending streamed response for the interface
+  bool StreamPending_(Stream& interface);
+  //Terminate and remove the pending streamed responses of the interface
+  void InterruptResponses_(Stream& interface);
+  //Move the streamed responses started with a wrapper of the interface
+  void RetargetResponses_(Stream& wrapper, Stream& interface);
+  //Number of pending streamed responses
+  uint8_t streams_size_ = 0;
+  //Pending streamed responses, in start order
+  stream_entry streams_[Config::max_streams];
+  #endif
+  #if SCPI_BLOCK_DATA
+  //Execute the message units up to a block, the last one reads the block
+  void ExecuteBlock_(session_t& session, Stream& interface, 
+                     const char* term_chars);
+  #endif
 
   #if SCPI_MAX_SPECIAL_COMMANDS
   //Max number of registered special commands.
-  const uint8_t max_special_commands = SCPI_MAX_SPECIAL_COMMANDS;
+  static const uint8_t max_special_commands = 
+    Config::max_special_commands;
+  static_assert(max_special_commands > 0, 
+                "max_special_commands can not be 0");
   //Number of registered special commands
   uint8_t special_codes_size_ = 0;
   //Registered special commands' hash storage
-  scpi_hash_t valid_special_codes_[SCPI_MAX_SPECIAL_COMMANDS];
+  hash_t valid_special_codes_[Config::max_special_commands];
   //Pointers to the functions to be called when a special command is received
-  SCPI_special_caller_t special_callers_[SCPI_MAX_SPECIAL_COMMANDS];
+  SCPI_special_caller_t special_callers_[Config::max_special_commands];
+  #if SCPI_HASH_SEARCH
+  //Tokens of the registered special commands
+  command_record special_records_[Config::max_special_commands];
+  #endif
   #endif
 };
 
+///Parser with the default sizes (see SCPI_Parser_Config).
+using SCPI_Parser = SCPI_Basic_Parser<SCPI_Parser_Config>;
+
+#if SCPI_RECEIVE_BUFFER_LENGTH
+/*!
+ Stream used by the special commands when a receive buffer is used.
+
+ The chars already stored in the parser's receive buffer are read first,
+ then the ones of the interface. Writes go directly to the interface.
+*/
+class SCPI_Input_Stream : public Stream {
+ public:
+  //Constructor
+  SCPI_Input_Stream(SCPI_Session_State& session, Stream& interface);
+  int available();
+  int read();
+  int peek();
+  size_t write(uint8_t c);
+  size_t write(const uint8_t* buffer, size_t size);
+  int availableForWrite();
+  void flush();
+  using Print::write;
+ protected:
+  SCPI_Session_State& session_;
+  Stream& interface_;
+};
+#endif
+
+#if SCPI_BLOCK_DATA
+/*!
+ Stream used to read the data of an IEEE 488.2 arbitrary block parameter.
+
+ It is passed as the interface to the procedure of a command whose last
+ parameter is a block header (e.g. ``#14`` for 4 bytes of data, or ``#0`` for
+ data up to the end of the message). Only the block data can be read,
+ the unread data is discarded after the procedure returns.  
+ Writes go directly to the interface.
+*/
+class SCPI_Block_Stream : public Stream {
+ public:
+  //Constructor
+  SCPI_Block_Stream(SCPI_Session_State& session, Stream& interface, 
+                    uint32_t length, bool indefinite, const char* term_chars,
+                    unsigned long timeout);
+  int available();
+  int read();
+  int peek();
+  size_t readBytes(char* buffer, size_t length);
+  size_t readBytes(uint8_t* buffer, size_t length) {
+    return this->readBytes((char*)buffer, length);
+  }
+  size_t write(uint8_t c);
+  size_t write(const uint8_t* buffer, size_t size);
+  int availableForWrite();
+  void flush();
+  using Print::write;
+  //Discard the unread data, return false on timeout
+  bool Discard();
+  //All the data of the block has been read
+  bool Finished();
+ protected:
+  //Get the next data char (-1 if not available yet)
+  int Next_();
+  SCPI_Session_State& session_;
+  Stream& interface_;
+  //Timeout for Discard, in miliseconds
+  unsigned long timeout_;
+  //Unread data chars (definite length blocks)
+  uint32_t remaining_;
+  //Indefinite length block (#0), ends with the termination chars
+  bool indefinite_;
+  const char* term_chars_;
+  //Termination chars matched, not returned as data yet
+  uint8_t matched_ = 0;
+  //Matched termination chars to be returned as data
+  uint8_t emit_index_ = 0;
+  uint8_t emit_count_ = 0;
+  //Char to be returned after the matched ones (-1 for none)
+  int pending_ = -1;
+  //Char read by peek (-1 for none)
+  int peeked_ = -1;
+  //The termination chars were found
+  bool ended_ = false;
+};
+#endif
+
+#if SCPI_RESPONSE_BUFFER_LENGTH
+/*!
+ Stream used to build and send the responses of a program message.
+
+ When SCPI_RESPONSE_BUFFER_LENGTH is not 0, the interface passed to the 
+ commands' procedures (and to the error handler for UnknownCommand and 
+ parameter errors) is a SCPI_Response:
+ ``SCPI_Response& response = static_cast<SCPI_Response&>(interface);``  
+ The written data is stored in a buffer and sent to the interface in one 
+ write when the program message has been executed (or the buffer is full).  
+ Data elements added with \c Add are separated by ',' (by ';' between the
+ responses of different commands) and the response message is terminated 
+ with a '\\n'. Reads go directly to the interface.
+*/
+class SCPI_Response : public Stream {
+ public:
+  //Constructor
+  SCPI_Response(Stream& interface, char* buffer, size_t length);
+  int available();
+  int read();
+  int peek();
+  size_t write(uint8_t c);
+  size_t write(const uint8_t* buffer, size_t size);
+  int availableForWrite();
+  void flush();
+  using Print::write;
+  //Add an integer data element
+  void Add(long value);
+  ///Add an integer data element.
+  void Add(int value) { this->Add((long)value); }
+  //Add a real data element, with the given number of decimals
+  void Add(double value, uint8_t decimals = 2);
+  //Add a data element (character data), written as is
+  void Add(const char* text);
+  //Add a data element (character data) stored in flash
+  void Add(const __FlashStringHelper* text);
+  //Add a string data element, between double quotes
+  void AddString(const char* text);
+ protected:
+  template <class Config> friend class SCPI_Basic_Parser;
+  //Write the separator of a new data element
+  void Separator_();
+  //Start the response of the next message unit
+  void NextUnit_();
+  //Terminate the response message and send the buffered data
+  void End_();
+  //Send the buffered data to the interface
+  void Send_();
+  Stream& interface_;
+  char* buffer_;
+  size_t length_;
+  //Number of buffered chars
+  size_t size_ = 0;
+  //Data elements of the current message unit
+  uint8_t elements_ = 0;
+  //A previous message unit added data elements
+  bool has_units_ = false;
+};
+#endif
+
 // Include the implementation code here
 // This allows Arduino IDE users to configure options with #define directives 
 //
@@ -249,6 +1172,16 @@ class SCPI_Parser {
 #include "Vrekrer_scpi_arrays_code.h"
 #include "Vrekrer_scpi_parser_code.h"
 #include "Vrekrer_scpi_parser_special_code.h"
+
+// The default parser is compiled here, and used by the other *.cpp files.
+// A SCPI_Basic_Parser<Config> used in other *.cpp files must be compiled
+// in the main.ino file, adding this line after the #include:
+// template class SCPI_Basic_Parser<Config>;
+template class SCPI_String_Array<SCPI_MAX_COMMAND_DEPTH>;
+#if SCPI_MAX_PARAMETERS != SCPI_MAX_COMMAND_DEPTH
+template class SCPI_String_Array<SCPI_MAX_PARAMETERS>;
+#endif
+template class SCPI_Basic_Parser<SCPI_Parser_Config>;
 #endif
 
 #endif //VREKRER_SCPI_PARSER_H_
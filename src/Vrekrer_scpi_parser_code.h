@@ -4,7 +4,7 @@
 
 
 //Do nothing function
-void DefaultErrorHandler(SCPI_C c, SCPI_P p, Stream& interface) {}
+void DefaultErrorHandler(SCPI_C, SCPI_P, Stream&) {}
 
 
 // ## SCPI_Registered_Commands member functions. ##
@@ -15,264 +15,2991 @@ void DefaultErrorHandler(SCPI_C c, SCPI_P p, Stream& interface) {}
  Example:  
   ``SCPI_Parser my_instrument``;
 */
-SCPI_Parser::SCPI_Parser(){
+template <class Config>
+SCPI_Basic_Parser<Config>::SCPI_Basic_Parser(){
   callers_[max_commands] = &DefaultErrorHandler;
+  #if SCPI_HANDLER_CONTEXT
+  context_callers_[max_commands] = NULL;
+  #endif
+  #if SCPI_STATISTICS
+  this->ResetStatistics();
+  #endif
+  #if SCPI_HEADER_CACHE
+  this->ClearHeaderCache_();
+  #endif
 }
 
-///Add a token to the tokens' storage
-void SCPI_Parser::AddToken_(char *token) {
+/*!
+ Add a token to the tokens' storage.
+
+ The token is stored in upper case, without the query (``?``) and numeric
+ suffix (``#``) symbols, in the fixed size token buffer
+ (``SCPI_TOKEN_BUFFER_LENGTH``). Its short and long forms are added to the sorted
+ table of valid keywords used by ``FindToken_``.
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::AddToken_(char *token) {
+  size_t token_size = strlen(token);
+  //Remove query symbols
+  if ((token_size > 0) and (token[token_size - 1] == '?')) token_size--;
+  //Remove the numeric suffix symbol
+  bool numeric_suffix = (token_size > 0) and (token[token_size - 1] == '#');
+  if (numeric_suffix) token_size--;
+  if ((token_size == 0) or (token_size > 255)) return;
+  uint8_t short_size = 0;
+  while ((short_size < token_size) and isupper(token[short_size]))
+    short_size++;
+
+  //Check if the token is allready added
+  for (uint16_t i = LowerBoundKeyword_(token, token_size, numeric_suffix);
+       i < keywords_size_; i++) {
+    if (CompareKeyword_(token, token_size, numeric_suffix, keywords_[i]) != 0)
+      break;
+    uint8_t j = keywords_[i].token;
+    if ( (tokens_short_length_[j] == short_size)
+         and (strlen(tokens_[j]) == token_size) ) return;
+  }
+
   if (tokens_size_ >= max_tokens) {
     setup_errors.token_overflow = true;
     return;
   }
-  size_t token_size = strlen(token);
-  //Remove query symbols
-  if (token[token_size - 1] == '?') token_size--;
-  for (uint8_t i = 0; i < tokens_size_; i++)
-    //Check if the token is allready added
-    if ( (strncmp(token, tokens_[i], token_size) == 0) 
-          and (token_size == strlen(tokens_[i])) ) return;
-  char *stored_token = new char [token_size + 1];
-  strncpy(stored_token, token, token_size);
-  stored_token[token_size] = '\0';
-  tokens_[tokens_size_] = stored_token;
-  tokens_size_++;
+  if (token_size + token_buffer_size_ >= token_buffer_length) {
+    setup_errors.token_buffer_overflow = true;
+    return;
+  }
+  char *stored_token = &token_buffer_[token_buffer_size_];
+  token_buffer_size_ += token_size + 1;
+  for (uint8_t i = 0; i < token_size; i++) stored_token[i] = toupper(token[i]);
+  stored_token[token_size] = '\0';
+  tokens_[tokens_size_] = stored_token;
+  tokens_short_length_[tokens_size_] = short_size;
+  if (short_size > 0) 
+    InsertKeyword_(tokens_size_, short_size, numeric_suffix);
+  if (short_size != token_size) 
+    InsertKeyword_(tokens_size_, token_size, numeric_suffix);
+  tokens_size_++;
+}
+
+/*!
+ Compare a keyword with a valid keyword entry.
+ @param keyword  Keyword, compared case-insensitively.
+ @param length  Length of the keyword.
+ @param numeric_suffix  Compare against numeric suffix capable tokens.
+ @param entry  Valid keyword entry.
+ @return <0, 0 or >0 if the keyword is lower, equal or greater than the entry.
+
+ Keywords are ordered alphabetically, then by length and then by the numeric
+ suffix flag.
+*/
+template <class Config>
+int SCPI_Basic_Parser<Config>::CompareKeyword_(const char* keyword,
+                                               uint8_t length,
+                                               bool numeric_suffix,
+                                               const keyword_entry& entry) {
+  const char* token = tokens_[entry.token];
+  uint8_t common_length = (length < entry.length) ? length : entry.length;
+  for (uint8_t k = 0; k < common_length; k++) {
+    int difference = (unsigned char)toupper(keyword[k]) 
+                     - (unsigned char)token[k];
+    if (difference != 0) return difference;
+  }
+  if (length != entry.length) return int(length) - int(entry.length);
+  return int(numeric_suffix) - int(entry.numeric_suffix);
+}
+
+///Position of the first valid keyword not lower than a keyword.
+template <class Config>
+uint16_t SCPI_Basic_Parser<Config>::LowerBoundKeyword_(const char* keyword,
+                                                       uint8_t length,
+                                                       bool numeric_suffix) {
+  uint16_t low = 0;
+  uint16_t high = keywords_size_;
+  while (low < high) {
+    uint16_t middle = (low + high) / 2;
+    if (CompareKeyword_(keyword, length, numeric_suffix, keywords_[middle]) > 0)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return low;
+}
+
+/*!
+ Insert a valid keyword keeping the keywords sorted.
+
+ Equal keywords keep their registration order, so the first registered token
+ wins when a keyword is ambiguous.
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::InsertKeyword_(uint8_t token, uint8_t length,
+                                               bool numeric_suffix) {
+  const char* keyword = tokens_[token];
+  uint16_t position = LowerBoundKeyword_(keyword, length, numeric_suffix);
+  while ( (position < keywords_size_) 
+          and (CompareKeyword_(keyword, length, numeric_suffix, 
+                               keywords_[position]) == 0) ) position++;
+  for (uint16_t i = keywords_size_; i > position; i--)
+    keywords_[i] = keywords_[i - 1];
+  keywords_[position].token = token;
+  keywords_[position].length = length;
+  keywords_[position].numeric_suffix = numeric_suffix;
+  keywords_size_++;
+}
+
+///Get the token index of a valid keyword (-1 if not valid).
+template <class Config>
+int SCPI_Basic_Parser<Config>::MatchKeyword_(const char* keyword,
+                                             uint8_t length,
+                                             bool numeric_suffix) {
+  if (length == 0) return -1;
+  #if SCPI_CONST_TABLE
+  if (table_tokens_ != NULL) 
+    return this->MatchTableKeyword_(keyword, length, numeric_suffix);
+  #endif
+  uint16_t position = LowerBoundKeyword_(keyword, length, numeric_suffix);
+  if ( (position < keywords_size_)
+       and (CompareKeyword_(keyword, length, numeric_suffix, 
+                            keywords_[position]) == 0) ) 
+    return keywords_[position].token;
+  return -1;
+}
+
+/*!
+ Get the token index that matches a command keyword.
+ @param keyword  Keyword of a command (without the query symbol).
+ @param length  Length of the keyword.
+ @param suffix[out]  If not NULL, the numeric suffix of the keyword: 0 if the
+        token does not accept numeric suffixes, 1 if it is omitted.
+ @return token index, or -1 if the keyword does not match any token.
+
+ Keywords ending in digits are also tested, without the digits, against the
+ tokens that accept numeric suffixes.  
+ Keywords ending in ``#`` only match tokens that accept numeric suffixes.
+*/
+template <class Config>
+int SCPI_Basic_Parser<Config>::FindToken_(const char* keyword, size_t length,
+                                          uint16_t* suffix) {
+  if (suffix != NULL) *suffix = 0;
+  if ((length == 0) or (length > 255)) return -1;
+  if (keyword[length - 1] == '#') return MatchKeyword_(keyword, length - 1, true);
+  int token = MatchKeyword_(keyword, length, false);
+  if (token >= 0) return token;
+  //Remove the numeric suffix and test the suffix capable tokens
+  size_t suffix_start = length;
+  while ((suffix_start > 0) and isdigit(keyword[suffix_start - 1])) 
+    suffix_start--;
+  token = MatchKeyword_(keyword, suffix_start, true);
+  if ((token < 0) or (suffix == NULL)) return token;
+  //The digits are converted once, here (saturated to 65535)
+  uint32_t value = (suffix_start == length) ? 1 : 0;
+  for (size_t i = suffix_start; i < length; i++) {
+    value = value * 10 + (keyword[i] - '0');
+    if (value > 65535) value = 65535;
+  }
+  *suffix = value;
+  return token;
+}
+
+/*!
+ Get a hash from a valid command
+ @param commands  Keywords of a command
+ @return hash
+
+ Return ``unknown_hash`` if the command contains  
+ keywords not registered as tokens.  
+ The hash is calculated including the TreeBase hash.  
+ @see SetCommandTreeBase
+*/
+template <class Config>
+typename SCPI_Basic_Parser<Config>::hash_t
+SCPI_Basic_Parser<Config>::GetCommandCode_(SCPI_Commands& commands) {
+  return this->GetCommandCode_(commands, tree_code_);
+}
+
+/*!
+ Get a hash from a valid command, starting at a given branch.
+ @param commands  Keywords of a command
+ @param tree_code  Hash of the branch (0 for root).
+ @param branch_code[out]  If not NULL, hash of the command without its last
+        keyword (the IEEE 488.2 header path), not set for unknown commands.
+ @param skip  Keywords of optional nodes that are not hashed, bit i for 
+        the keyword i (only with SCPI_OPTIONAL_NODES).
+ @return hash
+
+ Does not modify the parser, so it can be used concurrently by Execute.  
+ With SCPI_OPTIONAL_NODES, the tokens of the keywords and the keywords 
+ whose token is an optional node are stored in ``commands``.
+*/
+template <class Config>
+typename SCPI_Basic_Parser<Config>::hash_t
+SCPI_Basic_Parser<Config>::GetCommandCode_(SCPI_Commands& commands, 
+                                           hash_t tree_code,
+                                           hash_t* branch_code,
+                                           uint32_t skip) {
+  if (tree_code == invalid_hash) return invalid_hash;
+  hash_t code;
+  code = (tree_code == 0) ? hash_magic_offset : tree_code;
+  if (commands.Size()==0) return unknown_hash;
+  #if SCPI_OPTIONAL_NODES
+  commands.optional_keywords_ = 0;
+  #else
+  (void)skip;
+  #endif
+  //Number of hashed keywords, the suffixes of skipped ones are not stored
+  uint8_t level = 0;
+  //Loop all keywords in the command
+  for (uint8_t i = 0; i < commands.Size(); i++) {
+    //Get keywords's length
+    size_t header_length = strlen(commands[i]);
+    //For the last keyword remove the query symbol if needed
+    bool is_query = false;
+    if (i == commands.Size() - 1) {
+      is_query = (commands[i][header_length - 1] == '?');
+      if (is_query) header_length--;
+    }
+
+    //Get the token that matches the keyword (and its numeric suffix)
+    //If the keyword does not match any token return unknown_hash
+    int token = FindToken_(commands[i], header_length, 
+                           &commands.suffixes_[level]);
+    if (token < 0) return unknown_hash;
+    if (i == commands.Size() - 1) {
+      if (branch_code != NULL) *branch_code = (level > 0) ? code : tree_code;
+      #if SCPI_OPTIONAL_NODES
+      commands.path_depth_ = level;
+      #endif
+    }
+
+    #if SCPI_OPTIONAL_NODES
+    //Skipped optional nodes are not hashed (the query step is still applied)
+    bool skip_keyword = (i < 32) and ((skip >> i) & 1);
+    if ((i < 32) and this->IsOptionalToken_(token))
+      commands.optional_keywords_ |= uint32_t(1) << i;
+    if (i < SCPI_MAX_COMMAND_DEPTH) commands.tokens_[i] = token;
+    #else
+    const bool skip_keyword = false;
+    #endif
+    //Apply the hashing step using the token number
+    //hash(i) = hash(i - 1) * hash_magic_number + token
+    if (not skip_keyword) {
+      code *= hash_magic_number;
+      code += token;
+      level++;
+    } else {
+      commands.suffixes_[level] = 0;
+    }
+
+    //If last keyword is a query, add a hashing step
+    if (is_query) {
+      code *= hash_magic_number;
+      code -= 1;
+    }
+  }
+  return code;
+}
+
+/*!
+ Get the index of a registered command.
+ @param code  Hash of the command.
+ @return index of the command's caller,  
+ or ``max_commands`` (the ErrorHandler index) if the command is not registered.
+
+ The registered codes are kept sorted, so a binary search is used.  
+ When several commands share the same hash, the first registered one is found.
+*/
+template <class Config>
+uint8_t SCPI_Basic_Parser<Config>::FindCommand_(hash_t code) {
+  if ((code == unknown_hash) or (code == invalid_hash)) return max_commands;
+  uint8_t low = 0;
+  uint8_t high = codes_size_;
+  while (low < high) {
+    uint8_t middle = (low + high) / 2;
+    if (valid_codes_[middle] < code) low = middle + 1;
+    else high = middle;
+  }
+  if ((low < codes_size_) and (valid_codes_[low] == code)) return low;
+  return max_commands;
+}
+
+/*!
+ Get the caller of a command.
+ @param code  Hash of the command.
+ @param caller[out]  Procedure to be executed (the ErrorHandler if the 
+        command is not registered).
+ @return index of the command's caller, ``max_commands`` if the command is
+ not registered, or ``max_commands + 1`` for command table callers.
+*/
+template <class Config>
+uint8_t SCPI_Basic_Parser<Config>::FindCaller_(hash_t code,
+                                               SCPI_caller_t& caller) {
+  #if SCPI_CONST_TABLE
+  if (table_tokens_ != NULL) {
+    caller = this->FindTableCaller_(code);
+    if (caller != NULL) return max_commands + 1;
+    caller = callers_[max_commands];
+    return max_commands;
+  }
+  #endif
+  uint8_t index = this->FindCommand_(code);
+  caller = callers_[index];
+  return index;
+}
+
+/*!
+ Get the caller of a command, starting at a given branch.
+ @param commands  Keywords of the command.
+ @param tree_code  Hash of the branch (0 for root).
+ @param branch_code[out]  Hash of the command's header path.
+ @param caller[out]  Procedure to be executed.
+ @return index of the command's caller (see FindCaller_).
+
+ With optional nodes, commands are registered without the keywords of 
+ their optional nodes (``MEASure[:SCALar]:VOLTage?`` as ``MEAS:VOLT?``).
+ The header is searched with all its keywords first, then without all the
+ keywords that are an optional node in some command (``MEAS:SCAL:VOLT?`` 
+ as ``MEAS:VOLT?``), then without the other combinations of them. A 
+ command found without some keywords is only accepted if they are optional
+ nodes of that command, so ``TRIG:SEQ:SOUR`` is not found as ``TRIG`` for
+ ``TRIGger[:SEQuence][:IMMediate]`` when ``SOURce`` is optional elsewhere.
+*/
+template <class Config>
+uint8_t SCPI_Basic_Parser<Config>::FindBranchCaller_(SCPI_Commands& commands,
+                                                     hash_t tree_code,
+                                                     hash_t& branch_code,
+                                                     SCPI_caller_t& caller) {
+  hash_t code = this->GetCommandCode_(commands, tree_code, &branch_code);
+  uint8_t index = this->FindCaller_(code, caller);
+  #if SCPI_OPTIONAL_NODES
+  if ((index != max_commands) or not has_optional_) return index;
+  uint32_t optional = commands.optional_keywords_;
+  uint32_t skip = optional;
+  while (skip != 0) {
+    code = this->GetCommandCode_(commands, tree_code, &branch_code, skip);
+    index = this->FindCaller_(code, caller);
+    //The skipped keywords must be optional nodes of the found command
+    if ((index < max_commands) 
+        and this->HasKeywordTokens_(commands, skip, command_optional_[index]))
+      return index;
+    skip = (skip - 1) & optional;
+  }
+  //Not found, keep the suffixes of all the keywords
+  this->GetCommandCode_(commands, tree_code, &branch_code);
+  index = max_commands;
+  caller = callers_[max_commands];
+  #endif
+  return index;
+}
+
+/*!
+ Get the caller of a message unit header, following the header path.
+ @param commands  Keywords of the header.
+ @param header_end  End of the header in the message.
+ @param absolute  The header starts with ':'.
+ @param path[in,out]  Header path (root for the first message unit), it is 
+        updated to the path of the found command.
+ @param caller[out]  Procedure to be executed.
+ @return index of the command's caller (see FindCaller_).
+
+ As defined in IEEE 488.2 (7.6), the headers of a program message are 
+ relative to the path of the previous message unit (e.g. 
+ ``SOUR:VOLT 1;CURR 2`` executes ``SOUR:CURR 2``). Headers starting with 
+ ':' and common commands (``*IDN?``) are searched from the root, and common
+ commands do not change the path.  
+ Full headers without a leading ':' are still accepted: headers starting 
+ with a root keyword (the first keyword of a registered command) are 
+ searched from the root first, then relative to the path. Other headers 
+ are searched relative to the path first, then from the root.  
+ Unknown commands reset the path to the root.
+*/
+template <class Config>
+uint8_t SCPI_Basic_Parser<Config>::FindHeaderCaller_(SCPI_Commands& commands,
+                                                     const char* header_end,
+                                                     bool absolute,
+                                                     header_path& path,
+                                                     SCPI_caller_t& caller) {
+  bool common = (commands.Size() == 1) and (commands[0][0] == '*');
+  hash_t branch_code = 0;
+  uint8_t index = max_commands;
+  //Number of keywords of the path used to find the command
+  uint8_t depth = 0;
+  bool relative = (path.code != 0) and not (absolute or common);
+  //Headers starting with a root keyword are searched from the root first, 
+  //a relative hash could match another command
+  bool root_first = relative and (commands.Size() > 0) 
+                    and this->IsRootKeyword_(commands[0]);
+  if (relative and not root_first) {
+    //Continue from the already hashed path
+    index = this->FindBranchCaller_(commands, path.code, branch_code, caller);
+    if (index != max_commands) depth = path.depth;
+  }
+  if (index == max_commands) {
+    #if SCPI_HEADER_CACHE
+    index = this->GetCachedCommand_(commands, header_end, branch_code, 
+                                    caller);
+    #else
+    (void)header_end; //Only used by the header cache
+    index = this->FindBranchCaller_(commands, 0, branch_code, caller);
+    #endif
+  }
+  if ((index == max_commands) and root_first) {
+    index = this->FindBranchCaller_(commands, path.code, branch_code, caller);
+    if (index != max_commands) depth = path.depth;
+  }
+  if (index == max_commands) {
+    path.code = 0;
+    path.depth = 0;
+    return index;
+  }
+  //Suffixes are numbered from the root, the path's keywords come first
+  if (depth > 0) {
+    for (uint8_t i = commands.Size(); i > 0; i--) 
+      if (depth + i <= SCPI_MAX_COMMAND_DEPTH) 
+        commands.suffixes_[depth + i - 1] = commands.suffixes_[i - 1];
+    for (uint8_t i = 0; i < depth; i++) 
+      commands.suffixes_[i] = path.suffixes[i];
+  }
+  if (common) return index;
+  path.code = branch_code;
+  #if SCPI_OPTIONAL_NODES
+  path.depth = depth + commands.path_depth_;
+  #else
+  path.depth = depth + commands.Size() - 1;
+  #endif
+  if (path.depth > max_command_depth) path.depth = max_command_depth;
+  for (uint8_t i = 0; i < path.depth; i++) 
+    path.suffixes[i] = commands.suffixes_[i];
+  return index;
+}
+
+#if SCPI_OPTIONAL_NODES
+/*!
+ Remove the brackets of the optional nodes of a command.
+ @param command  Command, e.g. ``MEASure[:SCALar]:VOLTage?``, the brackets
+        are removed in place (``MEASure:SCALar:VOLTage?``).
+ @param optional[out]  Keywords inside brackets (``SCALar``), bit i for 
+        the keyword i of SCPI_Commands. Only the first 32 keywords can be 
+        optional nodes.
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::StripOptionalNodes_(char* command, 
+                                                    uint32_t& optional) {
+  optional = 0;
+  uint8_t keyword = 0;
+  bool in_keyword = false;
+  bool in_brackets = false;
+  char* end = command;
+  for (char* c = command; ; c++) {
+    if ((*c == '[') or (*c == ']')) {
+      in_brackets = (*c == '[');
+      continue;
+    }
+    *end++ = *c;
+    if (*c == '\0') return;
+    if (*c == ':') {
+      if (in_keyword) keyword++;
+      in_keyword = false;
+    } else if (not in_keyword) {
+      in_keyword = true;
+      if (in_brackets and (keyword < 32)) optional |= uint32_t(1) << keyword;
+    }
+  }
+}
+
+/*!
+ Flag the tokens of the optional keywords of a command.
+
+ Received headers are also searched without the keywords of these tokens
+ (see FindBranchCaller_), the commands themselves are hashed without their
+ own optional nodes only.
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::AddOptionalTokens_(SCPI_Commands& commands,
+                                                   uint32_t optional) {
+  for (uint8_t i = 0; (i < commands.Size()) and (i < 32); i++) {
+    if (not ((optional >> i) & 1)) continue;
+    size_t length = strlen(commands[i]);
+    if ((i == commands.Size() - 1) and (commands[i][length - 1] == '?')) 
+      length--;
+    int token = this->FindToken_(commands[i], length);
+    if (token < 0) continue;
+    optional_tokens_[token / 8] |= 1 << (token % 8);
+    has_optional_ = true;
+  }
+}
+
+/*!
+ Add the tokens of some keywords of a command to a set of tokens.
+ @param commands  Keywords of the command, as hashed by GetCommandCode_.
+ @param keywords  Keywords to be added, bit i for the keyword i.
+ @param tokens[in,out]  Set of tokens.
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::AddKeywordTokens_(
+    const SCPI_Commands& commands, uint32_t keywords, token_set& tokens) {
+  for (uint8_t i = 0; (i < commands.Size()) and (i < 32); i++) {
+    if (not ((keywords >> i) & 1)) continue;
+    uint8_t token = commands.tokens_[i];
+    tokens.bits[token / 8] |= 1 << (token % 8);
+  }
+}
+
+/*!
+ Test if the tokens of some keywords of a command are in a set of tokens.
+ @param commands  Keywords of the command, as hashed by GetCommandCode_.
+ @param keywords  Keywords to be tested, bit i for the keyword i.
+ @param tokens  Set of tokens.
+*/
+template <class Config>
+bool SCPI_Basic_Parser<Config>::HasKeywordTokens_(
+    const SCPI_Commands& commands, uint32_t keywords, 
+    const token_set& tokens) {
+  for (uint8_t i = 0; (i < commands.Size()) and (i < 32); i++) {
+    if (not ((keywords >> i) & 1)) continue;
+    uint8_t token = commands.tokens_[i];
+    if (not ((tokens.bits[token / 8] >> (token % 8)) & 1)) return false;
+  }
+  return true;
+}
+#endif
+
+///Flag the token of the first keyword of a command (a root keyword).
+template <class Config>
+void SCPI_Basic_Parser<Config>::AddRootToken_(const char* keyword) {
+  size_t length = strlen(keyword);
+  if ((length > 0) and (keyword[length - 1] == '?')) length--;
+  int token = this->FindToken_(keyword, length);
+  if (token >= 0) root_tokens_[token / 8] |= 1 << (token % 8);
+}
+
+/*!
+ Test if a keyword is the first keyword of a registered command.
+
+ Command tables do not flag their root keywords, every keyword is considered
+ a root keyword.
+*/
+template <class Config>
+bool SCPI_Basic_Parser<Config>::IsRootKeyword_(const char* keyword) {
+  #if SCPI_CONST_TABLE
+  if (table_tokens_ != NULL) return true;
+  #endif
+  size_t length = strlen(keyword);
+  if ((length > 0) and (keyword[length - 1] == '?')) length--;
+  int token = this->FindToken_(keyword, length);
+  return (token >= 0) and ((root_tokens_[token / 8] >> (token % 8)) & 1);
+}
+
+///Test if a hash is allready used by a registered command.
+template <class Config>
+bool SCPI_Basic_Parser<Config>::IsRegistered_(hash_t code) {
+  if (this->FindCommand_(code) != max_commands) return true;
+  #if SCPI_MAX_SPECIAL_COMMANDS
+  for (uint8_t i = 0; i < special_codes_size_; i++)
+    if (valid_special_codes_[i] == code) return true;
+  #endif
+  return false;
+}
+
+#if SCPI_CONST_TABLE
+/*!
+ Set the compile time command table.
+ @param header  Tokens and magic numbers of the table (in flash).
+ @param codes  Sorted hashes of the commands (in flash).
+ @param callers  Procedures of the commands (in flash).
+ @param size  Number of commands.
+
+ The table replaces the registered commands and tokens, so RegisterCommand,
+ RegisterSpecialCommand and SetCommandTreeBase must not be used with it.  
+ The hash magic numbers are set to the ones used to build the table.  
+ Tables do not support optional nodes (``[:KEYWord]``, see 
+ SCPI_OPTIONAL_NODES), each form of a command needs its own entry.
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::SetCommandTable_(
+    const SCPI_Const_Table_Header* header, const hash_t* codes,
+    const SCPI_caller_t* callers, uint8_t size) {
+  if (frozen_) return;
+  #if SCPI_HEADER_CACHE
+  this->ClearHeaderCache_();
+  #endif
+  memcpy_P(&table_tokens_, &header->tokens, sizeof(table_tokens_));
+  memcpy_P(&hash_magic_number, &header->magic_number, sizeof(hash_t));
+  memcpy_P(&hash_magic_offset, &header->magic_offset, sizeof(hash_t));
+  table_codes_ = codes;
+  table_callers_ = callers;
+  table_size_ = size;
+}
+
+/*!
+ Get the token index of a valid keyword in the command table's tokens.
+ @return token index, or -1 if not valid.
+
+ The tokens' list is read from flash, the first matching token wins.
+*/
+template <class Config>
+int SCPI_Basic_Parser<Config>::MatchTableKeyword_(const char* keyword,
+                                                  uint8_t length,
+                                                  bool numeric_suffix) {
+  const char* token = table_tokens_;
+  char first = toupper(keyword[0]);
+  for (int index = 0; pgm_read_byte(token) != '\0'; index++) {
+    char c = pgm_read_byte(token);
+    //Skip the tokens with a different first char
+    if (toupper(c) != first) {
+      while ((c != ':') and (c != '\0')) c = pgm_read_byte(++token);
+      if (c == ':') token++;
+      continue;
+    }
+    //Get the token's length and short form length
+    uint8_t token_length = 0;
+    uint8_t short_length = 0;
+    while ((c != ':') and (c != '\0')) {
+      if ((short_length == token_length) and isupper(c)) short_length++;
+      token_length++;
+      c = pgm_read_byte(token + token_length);
+    }
+    bool suffix = (token_length > 0) 
+                  and (pgm_read_byte(token + token_length - 1) == '#');
+    uint8_t long_length = suffix ? token_length - 1 : token_length;
+    if ( (suffix == numeric_suffix) 
+         and ((length == short_length) or (length == long_length)) ) {
+      uint8_t k = 0;
+      while ( (k < length) and (toupper(keyword[k]) 
+                                == toupper(pgm_read_byte(token + k))) ) k++;
+      if (k == length) return index;
+    }
+    token += token_length;
+    if (c == ':') token++;
+  }
+  return -1;
+}
+
+/*!
+ Get the procedure of a command in the command table.
+ @param code  Hash of the command.
+ @return the command's procedure, or NULL if the command is not in the table.
+*/
+template <class Config>
+SCPI_caller_t SCPI_Basic_Parser<Config>::FindTableCaller_(hash_t code) {
+  if ((code == unknown_hash) or (code == invalid_hash)) return NULL;
+  uint8_t low = 0;
+  uint8_t high = table_size_;
+  hash_t table_code;
+  while (low < high) {
+    uint8_t middle = (low + high) / 2;
+    memcpy_P(&table_code, &table_codes_[middle], sizeof(hash_t));
+    if (table_code < code) low = middle + 1;
+    else high = middle;
+  }
+  if (low == table_size_) return NULL;
+  memcpy_P(&table_code, &table_codes_[low], sizeof(hash_t));
+  if (table_code != code) return NULL;
+  SCPI_caller_t caller;
+  memcpy_P(&caller, &table_callers_[low], sizeof(caller));
+  return caller;
+}
+#endif
+
+#if SCPI_HASH_SEARCH
+/*!
+ Store the tokens of a command, including the TreeBase ones.
+ @param commands  Keywords of the command.
+ @param record  Record where the tokens are stored.
+ @param skip  Keywords that are not stored (optional nodes), bit i for the
+        keyword i.
+
+ The record size is set to 0 if the command is not valid.
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::RecordCommand_(SCPI_Commands& commands, 
+                                               command_record& record,
+                                               uint32_t skip) {
+  uint8_t size = tree_record_.size;
+  for (uint8_t i = 0; i < size; i++) record.tokens[i] = tree_record_.tokens[i];
+  record.size = 0;
+  record.is_query = false;
+  if ((tree_code_ == invalid_hash) or (commands.Size() == 0)) return;
+  for (uint8_t i = 0; i < commands.Size(); i++) {
+    size_t length = strlen(commands[i]);
+    if (i == commands.Size() - 1) {
+      record.is_query = (commands[i][length - 1] == '?');
+      if (record.is_query) length--;
+    }
+    int token = this->FindToken_(commands[i], length);
+    if (token < 0) return;
+    if ((i < 32) and ((skip >> i) & 1)) continue;
+    if (size >= max_command_depth) return;
+    record.tokens[size] = token;
+    size++;
+  }
+  record.size = size;
+}
+
+///Hash of a recorded command using the current magic numbers.
+template <class Config>
+typename SCPI_Basic_Parser<Config>::hash_t
+SCPI_Basic_Parser<Config>::RecordCode_(const command_record& record) {
+  if (record.size == 0) return invalid_hash;
+  hash_t code = hash_magic_offset;
+  for (uint8_t i = 0; i < record.size; i++) {
+    code *= hash_magic_number;
+    code += record.tokens[i];
+  }
+  if (record.is_query) {
+    code *= hash_magic_number;
+    code -= 1;
+  }
+  return code;
+}
+
+/*!
+ Recalculate the hashes of all the registered commands.
+ @param magic_number  Magic number to be used.
+ @param magic_offset  Magic offset to be used.
+ @return true if there are no hash crashes.
+
+ The codes are recalculated in place, valid_codes_ is not sorted.
+*/
+template <class Config>
+bool SCPI_Basic_Parser<Config>::TestHashParameters_(hash_t magic_number, 
+                                                    hash_t magic_offset) {
+  hash_magic_number = magic_number;
+  hash_magic_offset = magic_offset;
+  for (uint8_t i = 0; i < codes_size_; i++) 
+    valid_codes_[i] = this->RecordCode_(records_[i]);
+  #if SCPI_MAX_SPECIAL_COMMANDS
+  for (uint8_t i = 0; i < special_codes_size_; i++) 
+    valid_special_codes_[i] = this->RecordCode_(special_records_[i]);
+  #endif
+
+  for (uint8_t i = 0; i < codes_size_; i++) {
+    if (records_[i].size == 0) continue;
+    hash_t code = valid_codes_[i];
+    if ((code == unknown_hash) or (code == invalid_hash)) return false;
+    for (uint8_t j = 0; j < i; j++)
+      if ((records_[j].size != 0) and (valid_codes_[j] == code)) return false;
+    #if SCPI_MAX_SPECIAL_COMMANDS
+    for (uint8_t j = 0; j < special_codes_size_; j++)
+      if (valid_special_codes_[j] == code) return false;
+    #endif
+  }
+  #if SCPI_MAX_SPECIAL_COMMANDS
+  for (uint8_t i = 0; i < special_codes_size_; i++) {
+    if (special_records_[i].size == 0) continue;
+    hash_t code = valid_special_codes_[i];
+    if ((code == unknown_hash) or (code == invalid_hash)) return false;
+    for (uint8_t j = 0; j < i; j++)
+      if ( (special_records_[j].size != 0) 
+           and (valid_special_codes_[j] == code) ) return false;
+  }
+  #endif
+  return true;
+}
+
+/*!
+ Search hash magic numbers without crashes for the registered commands.
+ @return true if all the registered commands have unique hashes.
+
+ Call it once, after all the commands are registered.  
+ If the current magic numbers produce hash crashes, prime magic numbers
+ (3 to 251) and magic offsets (0 to 255) are tested until every registered
+ command gets a unique hash, then ``hash_magic_number`` and
+ ``hash_magic_offset`` are updated.  
+ If no crash free magic numbers are found, the original ones are restored
+ and false is returned, use a larger ``SCPI_HASH_TYPE`` in that case.  
+ Only available if ``SCPI_HASH_SEARCH`` is defined as ``1``.
+*/
+template <class Config>
+bool SCPI_Basic_Parser<Config>::FixHashCrashes() {
+  if (frozen_) return not setup_errors.hash_crash;
+  #if SCPI_HEADER_CACHE
+  this->ClearHeaderCache_();
+  #endif
+  hash_t magic_number = hash_magic_number;
+  hash_t magic_offset = hash_magic_offset;
+  bool found = this->TestHashParameters_(magic_number, magic_offset);
+  for (unsigned int number = 3; (number < 256) and not found; number += 2) {
+    bool is_prime = true;
+    for (unsigned int d = 3; d * d <= number; d += 2)
+      if (number % d == 0) is_prime = false;
+    if (not is_prime) continue;
+    for (unsigned int offset = 0; (offset < 256) and not found; offset++)
+      found = this->TestHashParameters_(number, offset);
+  }
+  if (not found) this->TestHashParameters_(magic_number, magic_offset);
+
+  //Sort the new codes (and the callers in the same order)
+  for (uint8_t i = 1; i < codes_size_; i++) {
+    hash_t code = valid_codes_[i];
+    SCPI_caller_t caller = callers_[i];
+    #if SCPI_HANDLER_CONTEXT
+    SCPI_context_caller_t context_caller = context_callers_[i];
+    void* context = contexts_[i];
+    #endif
+    command_record record = records_[i];
+    #if SCPI_OPTIONAL_NODES
+    token_set command_optional = command_optional_[i];
+    #endif
+    #if SCPI_STATISTICS
+    command_statistics command_stats = command_stats_[i];
+    #endif
+    uint8_t position = i;
+    while ((position > 0) and (valid_codes_[position - 1] > code)) {
+      valid_codes_[position] = valid_codes_[position - 1];
+      callers_[position] = callers_[position - 1];
+      #if SCPI_HANDLER_CONTEXT
+      context_callers_[position] = context_callers_[position - 1];
+      contexts_[position] = contexts_[position - 1];
+      #endif
+      records_[position] = records_[position - 1];
+      #if SCPI_OPTIONAL_NODES
+      command_optional_[position] = command_optional_[position - 1];
+      #endif
+      #if SCPI_STATISTICS
+      command_stats_[position] = command_stats_[position - 1];
+      #endif
+      position--;
+    }
+    valid_codes_[position] = code;
+    callers_[position] = caller;
+    #if SCPI_HANDLER_CONTEXT
+    context_callers_[position] = context_caller;
+    contexts_[position] = context;
+    #endif
+    records_[position] = record;
+    #if SCPI_OPTIONAL_NODES
+    command_optional_[position] = command_optional;
+    #endif
+    #if SCPI_STATISTICS
+    command_stats_[position] = command_stats;
+    #endif
+  }
+  //Update the TreeBase hash for the next RegisterCommand calls
+  if (tree_code_ != invalid_hash)
+    tree_code_ = (tree_record_.size == 0) ? 0 : this->RecordCode_(tree_record_);
+
+  setup_errors.hash_crash = not found;
+  return found;
+}
+#endif
+
+/*!
+ Change the TreeBase for the next RegisterCommand calls.
+ @param tree_base  TreeBase to be used.  
+        An empty string ``""`` sets the TreeBase to root.
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::SetCommandTreeBase(char* tree_base) {
+  if (frozen_) return;
+  #if SCPI_HEADER_CACHE
+  this->ClearHeaderCache_();
+  #endif
+  uint32_t optional = 0;
+  #if SCPI_OPTIONAL_NODES
+  this->StripOptionalNodes_(tree_base, optional);
+  tree_optional_ = token_set();
+  #endif
+  SCPI_Commands tree_tokens(tree_base);
+  if (tree_tokens.Size() == 0) {
+    tree_code_ = 0;
+    tree_length_ = 0;
+    #if SCPI_HASH_SEARCH
+    tree_record_.size = 0;
+    #endif
+    return;
+  }
+  for (uint8_t i = 0; i < tree_tokens.Size(); i++)
+    AddToken_(tree_tokens[i]);
+  this->AddRootToken_(tree_tokens[0]);
+  #if SCPI_OPTIONAL_NODES
+  this->AddOptionalTokens_(tree_tokens, optional);
+  #endif
+  tree_code_ = 0;
+  #if SCPI_HASH_SEARCH
+  tree_record_.size = 0;
+  this->RecordCommand_(tree_tokens, tree_record_, optional);
+  #endif
+  tree_code_ = this->GetCommandCode_(tree_tokens, 0, NULL, optional);
+  #if SCPI_OPTIONAL_NODES
+  this->AddKeywordTokens_(tree_tokens, optional, tree_optional_);
+  #endif
+  tree_length_ = tree_tokens.Size();
+  if (tree_tokens.overflow_error) {
+    setup_errors.branch_overflow = true;
+    tree_code_ = invalid_hash;
+  } 
+}
+
+/*!
+ SetCommandTreeBase version with RAM string support.
+
+ Example:  
+ ``my_instrument.SetCommandTreeBase("SYSTem:LED");``  
+ For lower RAM usage use the Flash strings version.
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::SetCommandTreeBase(const char* tree_base) {
+  if (frozen_) return;
+  strcpy(session_.msg_buffer_, tree_base);
+  this->SetCommandTreeBase(session_.msg_buffer_);
+}
+
+/*!
+ SetCommandTreeBase version with Flash strings (F() macro) support.
+
+ Example:  
+  ``my_instrument.SetCommandTreeBase(F("SYSTem:LED"));``
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::SetCommandTreeBase(
+    const __FlashStringHelper* tree_base) {
+  if (frozen_) return;
+  strcpy_P(session_.msg_buffer_, (const char *) tree_base);
+  this->SetCommandTreeBase(session_.msg_buffer_);
+}
+
+/*!
+ Registers a new valid command and associate a procedure to it.
+ @param command  New valid command.
+ @param caller  Procedure associated to the valid command.
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::RegisterCommand(char* command,
+                                                SCPI_caller_t caller) {
+  uint8_t position = this->AddCommand_(command);
+  if (position == max_commands) return;
+  callers_[position] = caller;
+  #if SCPI_HANDLER_CONTEXT
+  context_callers_[position] = NULL;
+  #endif
+}
+
+#if SCPI_HANDLER_CONTEXT
+/*!
+ Registers a new valid command and associate a procedure with a context.
+ @param command  New valid command.
+ @param caller  Procedure associated to the valid command.
+ @param context  Pointer passed to the procedure (e.g. an object).
+
+ The procedure gets the commands and parameters by reference, see 
+ SCPI_Method to call a member function of an object.
+
+ Example:  
+  ``my_instrument.RegisterCommand("OUTPut", &SetOutput, &channel_a);``
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::RegisterCommand(char* command,
+                                                SCPI_context_caller_t caller,
+                                                void* context) {
+  uint8_t position = this->AddCommand_(command);
+  if (position == max_commands) return;
+  callers_[position] = NULL;
+  context_callers_[position] = caller;
+  contexts_[position] = context;
+}
+
+///RegisterCommand version with a context and RAM string support.
+template <class Config>
+void SCPI_Basic_Parser<Config>::RegisterCommand(const char* command,
+                                                SCPI_context_caller_t caller,
+                                                void* context) {
+  if (frozen_) return;
+  strcpy(session_.msg_buffer_, command);
+  this->RegisterCommand(session_.msg_buffer_, caller, context);
+}
+
+///RegisterCommand version with a context and Flash strings support.
+template <class Config>
+void SCPI_Basic_Parser<Config>::RegisterCommand(
+    const __FlashStringHelper* command, SCPI_context_caller_t caller,
+    void* context) {
+  if (frozen_) return;
+  strcpy_P(session_.msg_buffer_, (const char *) command);
+  this->RegisterCommand(session_.msg_buffer_, caller, context);
+}
+#endif
+
+/*!
+ Add the hash of a new command, keeping the hashes sorted.
+ @param command  New valid command.
+ @return Position of the new command, the caller of the command must be set
+ there. ``max_commands`` if the command can not be stored.
+*/
+template <class Config>
+uint8_t SCPI_Basic_Parser<Config>::AddCommand_(char* command) {
+  if (frozen_) return max_commands;
+  #if SCPI_HEADER_CACHE
+  this->ClearHeaderCache_();
+  #endif
+  if (codes_size_ >= max_commands) {
+    setup_errors.command_overflow = true;
+    return max_commands;
+  }
+  uint32_t optional = 0;
+  #if SCPI_OPTIONAL_NODES
+  this->StripOptionalNodes_(command, optional);
+  #endif
+  SCPI_Commands command_tokens(command);
+  for (uint8_t i = 0; i < command_tokens.Size(); i++)
+    this->AddToken_(command_tokens[i]);
+  if ((tree_code_ == 0) and (command_tokens.Size() > 0)) 
+    this->AddRootToken_(command_tokens[0]);
+  #if SCPI_OPTIONAL_NODES
+  this->AddOptionalTokens_(command_tokens, optional);
+  #endif
+  //The keywords of its optional nodes are not hashed
+  hash_t code = this->GetCommandCode_(command_tokens, tree_code_, NULL, 
+                                      optional);
+  
+  //Check for errors
+  if (code == unknown_hash) code = invalid_hash;
+  bool overflow_error = command_tokens.overflow_error;
+  overflow_error |= (tree_length_+command_tokens.Size()) 
+                    > max_command_depth;
+  setup_errors.command_overflow |= overflow_error;
+  if (overflow_error) code = invalid_hash;
+  if ((code != invalid_hash) and this->IsRegistered_(code)) 
+    setup_errors.hash_crash = true;
+  #if SCPI_HASH_SEARCH
+  command_record record;
+  this->RecordCommand_(command_tokens, record, optional);
+  if (overflow_error) record.size = 0;
+  //A valid command with a reserved hash is also a hash crash
+  if ((record.size != 0) and (code == invalid_hash)) 
+    setup_errors.hash_crash = true;
+  #endif
+
+  //Keep the codes sorted (and the callers in the same order)
+  //Equal codes keep their registration order
+  uint8_t position = codes_size_;
+  while ((position > 0) and (valid_codes_[position - 1] > code)) {
+    valid_codes_[position] = valid_codes_[position - 1];
+    callers_[position] = callers_[position - 1];
+    #if SCPI_HANDLER_CONTEXT
+    context_callers_[position] = context_callers_[position - 1];
+    contexts_[position] = contexts_[position - 1];
+    #endif
+    #if SCPI_HASH_SEARCH
+    records_[position] = records_[position - 1];
+    #endif
+    #if SCPI_OPTIONAL_NODES
+    command_optional_[position] = command_optional_[position - 1];
+    #endif
+    #if SCPI_STATISTICS
+    command_stats_[position] = command_stats_[position - 1];
+    #endif
+    position--;
+  }
+  valid_codes_[position] = code;
+  #if SCPI_OPTIONAL_NODES
+  command_optional_[position] = tree_optional_;
+  this->AddKeywordTokens_(command_tokens, optional, 
+                          command_optional_[position]);
+  #endif
+  #if SCPI_STATISTICS
+  command_stats_[position] = command_statistics();
+  #endif
+  #if SCPI_HASH_SEARCH
+  records_[position] = record;
+  #endif
+  codes_size_++;
+  return position;
+}
+
+/*!
+ RegisterCommand version with RAM string support.
+
+ Example:  
+  ``my_instrument.RegisterCommand("*IDN?", &Identify);``  
+ For lower RAM usage use the Flash strings version.
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::RegisterCommand(const char* command,
+                                                SCPI_caller_t caller) {
+  if (frozen_) return;
+  strcpy(session_.msg_buffer_, command);
+  this->RegisterCommand(session_.msg_buffer_, caller);
+}
+
+/*!
+ RegisterCommand version with Flash strings (F() macro) support.
+
+ Example:  
+  ``my_instrument.RegisterCommand(F("*IDN?"), &Identify);``
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::RegisterCommand(
+    const __FlashStringHelper* command, SCPI_caller_t caller) {
+  if (frozen_) return;
+  strcpy_P(session_.msg_buffer_, (const char *) command);
+  this->RegisterCommand(session_.msg_buffer_, caller);
+}
+
+/*!
+ Registers the commands of an array stored in flash (PROGMEM).
+ @param commands  Array of commands and procedures, the commands' strings
+        must also be stored in flash.
+ @param size  Number of elements of the array.
+
+ An element with a ``NULL`` procedure changes the TreeBase
+ (see SetCommandTreeBase) for the next elements.  
+ If the TreeBase was changed, it is set to root after the last element.
+
+ Example:  
+  ``const char idn[] PROGMEM = "*IDN?";``  
+  ``const SCPI_Const_Command commands[] PROGMEM = {{idn, &Identify}};``  
+  ``my_instrument.RegisterCommands(commands);``
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::RegisterCommands(
+    const SCPI_Const_Command* commands, uint8_t size) {
+  bool tree_changed = false;
+  for (uint8_t i = 0; i < size; i++) {
+    SCPI_Const_Command entry;
+    memcpy_P(&entry, &commands[i], sizeof(entry));
+    const __FlashStringHelper* command = 
+      reinterpret_cast<const __FlashStringHelper*>(entry.command);
+    if (entry.caller == NULL) {
+      this->SetCommandTreeBase(command);
+      tree_changed = true;
+    } else {
+      this->RegisterCommand(command, entry.caller);
+    }
+  }
+  if (tree_changed) this->SetCommandTreeBase(F(""));
+}
+
+/*!
+ Set the function to be used by the error handler.
+
+ Example:  
+  ``my_instrument.SetErrorHandler(&myErrorHandler);``
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::SetErrorHandler(SCPI_caller_t caller){
+  if (frozen_) return;
+  #if SCPI_HEADER_CACHE
+  this->ClearHeaderCache_();
+  #endif
+  callers_[max_commands] = caller;
+  #if SCPI_HANDLER_CONTEXT
+  context_callers_[max_commands] = NULL;
+  #endif
+}
+
+#if SCPI_HANDLER_CONTEXT
+/*!
+ SetErrorHandler version for a procedure with a context.
+
+ Example:  
+  ``my_instrument.SetErrorHandler(&ReportError, &error_log);``
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::SetErrorHandler(SCPI_context_caller_t caller,
+                                                void* context) {
+  if (frozen_) return;
+  #if SCPI_HEADER_CACHE
+  this->ClearHeaderCache_();
+  #endif
+  callers_[max_commands] = NULL;
+  context_callers_[max_commands] = caller;
+  contexts_[max_commands] = context;
+}
+#endif
+
+/*!
+ Makes the registered commands read only.
+
+ Call it once, after all the commands are registered (and after
+ FixHashCrashes, if used). Later calls to the functions that register
+ commands, change the TreeBase, the error handler or the command table are
+ ignored.  
+ Afterwards Execute does not modify the parser, so several threads can
+ execute messages at the same time without locks. Each thread must use its
+ own message buffer (or SCPI_Session for GetMessage and ProcessInput).  
+ The header cache is not used once the parser is frozen.  
+ This state is shared by all the threads and is not synchronised:
+ - ``last_error``, the SCPI_STATISTICS counters and the error queue
+   (SCPI_ERROR_QUEUE_LENGTH), written by every message.
+ - The overlapped operations (SCPI_MAX_OPERATIONS): the pending 
+   operations, the wait queue and the ``*OPC`` state.
+ - The streamed responses (SCPI_MAX_STREAMS): the stream table, also 
+   written when a message interrupts a stream.
+
+ Leave SCPI_MAX_OPERATIONS and SCPI_MAX_STREAMS at 0 for concurrent 
+ execution, or execute all the messages that use them (and call 
+ PollOperations and PollResponses) from one thread. The error queue and 
+ the statistics only report a consistent state when one thread executes
+ messages.
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::Freeze() {
+  frozen_ = true;
+}
+
+
+/*!
+ Process a message and execute it if a valid command is found.
+ @param message  Message to be processed.
+ @param interface  The source of the message.
+ 
+ Commands and parameters are extracted from the message,  
+ if a valid command is found, its associated procedure is executed,  
+ otherwise the error handler is called (UnknownCommand error).  
+ The command' tokens and parameters, and the interface is passed
+ to the executed procedure.  
+ Message units separated by ';' are relative to the previous header path,
+ e.g. ``SOUR:VOLT 1;CURR 2`` (see FindHeaderCaller_). The procedure gets 
+ the keywords as received (``CURR``).
+ @see GetMessage
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::Execute(char* message, Stream &interface) {
+  //Header path of the message units (IEEE 488.2), starts at the root
+  header_path path;
+  this->Execute_(message, interface, path);
+}
+
+/*!
+ Execute the message units of a message, starting at a header path.
+ @param message  Message to be processed.
+ @param interface  The source of the message.
+ @param path[in,out]  Header path of the first message unit, it is updated
+        to the path after the last one.
+
+ Used for the parts of a message executed separately, the message units 
+ queued after ``*WAI`` and the unit with a block parameter keep the path of
+ the previous units (e.g. ``SOUR:VOLT 1;*WAI;CURR 2``).
+ @see Execute
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::Execute_(char* message, Stream &interface,
+                                         header_path& path) {
+  #if SCPI_RESPONSE_BUFFER_LENGTH
+  //The responses are sent once, after executing all the message units
+  char response_buffer[SCPI_RESPONSE_BUFFER_LENGTH];
+  SCPI_Response response(interface, response_buffer, 
+                         SCPI_RESPONSE_BUFFER_LENGTH);
+  #else
+  Stream& response = interface;
+  #endif
+  #if SCPI_MAX_STREAMS
+  //A new message interrupts the streamed responses of the interface, as
+  //defined in IEEE 488.2 (6.3.2.3), e.g. messages from Feed
+  if (this->StreamPending_(interface)) {
+    this->InterruptResponses_(interface);
+    this->SetError_(ErrorCode::QueryInterrupted);
+    this->CallErrorHandler_(interface);
+  }
+  #endif
+  while (message != NULL) {
+    #if SCPI_MAX_OPERATIONS
+    //After *WAI or *OPC? the message units are queued
+    if (waiting_) {
+      this->QueueMessage_(NULL, message, interface, path);
+      break;
+    }
+    #endif
+    #if SCPI_RESPONSE_BUFFER_LENGTH
+    response.NextUnit_();
+    #endif
+    #if SCPI_STATISTICS
+    unsigned long unit_start = micros();
+    #endif
+    //Split the header and the parameters of the message unit in one pass,
+    //message points to the next message unit (or NULL) afterwards.
+    SCPI_Commands commands;
+    SCPI_Parameters parameters;
+    while (isspace(*message)) message++;
+    bool absolute = (message[0] == ':');
+    char* header_end = commands.Tokenize_(message);
+    char separator = header_end[0];
+    header_end[0] = '\0';
+    message = NULL;
+    if (separator == ';') {
+      message = header_end + 1;
+    } else if (separator != '\0') {
+      commands.not_processed_message = header_end + 1;
+      message = parameters.Split_(header_end + 1);
+      //The parameters over the configured max are ignored
+      while (parameters.Size() > max_parameters) {
+        parameters.Pop();
+        parameters.overflow_error = true;
+      }
+    }
+    #if SCPI_MAX_OPERATIONS
+    uint8_t sync = ((commands.Size() == 1) and (commands[0][0] == '*')) 
+                   ? this->SyncCommand_(commands[0]) : 0;
+    if ((sync == 1) and (operations_size_ > 0)) {
+      opc_armed_ = true;
+    } else if (sync == 1) {
+      operation_complete = true;
+    } else if ((sync > 1) and (operations_size_ > 0)) {
+      //Wait for the pending operations, *OPC? is executed afterwards
+      waiting_ = true;
+      if (sync == 2) {
+        this->QueueMessage_("*OPC?", message, interface, path);
+        message = NULL;
+      }
+    } else if (sync == 2) {
+      #if SCPI_RESPONSE_BUFFER_LENGTH
+      response.Add(1);
+      #else
+      response.println(1);
+      #endif
+    }
+    if (sync != 0) continue;
+    #endif
+    //Unknown commands get the ErrorHandler index
+    SCPI_caller_t caller;
+    uint8_t index = this->FindHeaderCaller_(commands, header_end, absolute,
+                                            path, caller);
+    if (index == max_commands) 
+      this->SetError_(ErrorCode::UnknownCommand, commands.First(), header_end);
+    #if SCPI_ERROR_QUEUE_LENGTH
+    //The parameters that do not fit are ignored
+    if (parameters.overflow_error and (index != max_commands))
+      this->PushError_(-223, commands.First(), header_end);
+    #endif
+    #if SCPI_STATISTICS
+    //Only the ErrorHandler statistics are kept for command tables
+    this->CallMeasured_(index, caller, commands, parameters, response,
+                        unit_start);
+    #else
+    this->Call_(index, caller, commands, parameters, response);
+    #endif
+  }
+  #if SCPI_RESPONSE_BUFFER_LENGTH
+  response.End_();
+  #if SCPI_MAX_STREAMS
+  this->RetargetResponses_(response, interface);
+  #endif
+  #endif
+}
+
+#if SCPI_HEADER_CACHE
+/*!
+ Get the caller of a message unit header, searched from the root.
+ @param commands  Keywords of the header (split by SCPI_Commands).
+ @param header_end  End of the header in the message.
+ @param branch_code[out]  Hash of the header path after the command.
+ @param caller[out]  Procedure to be executed.
+ @return index of the command's caller (see FindCaller_).
+
+ Headers repeated often (e.g. polling queries) are found in a direct mapped
+ cache, keyed on the header bytes, so they are not hashed again.  
+ The cache is not used after Freeze, as it is modified by each lookup.
+*/
+template <class Config>
+uint8_t SCPI_Basic_Parser<Config>::GetCachedCommand_(SCPI_Commands& commands, 
+                                                     const char* header_end, 
+                                                     hash_t& branch_code,
+                                                     SCPI_caller_t& caller) {
+  const char* header = (commands.Size() > 0) ? commands[0] : header_end;
+  size_t length = header_end - header;
+  if ( frozen_ or (length == 0) 
+       or (length > SCPI_HEADER_CACHE_KEY_LENGTH) ) {
+    return this->FindBranchCaller_(commands, 0, branch_code, caller);
+  }
+  uint16_t key = 0;
+  for (size_t i = 0; i < length; i++) key = key * 33 + (uint8_t)header[i];
+  header_cache_entry& entry = header_cache_[key % SCPI_HEADER_CACHE];
+  if ( (entry.length == length) 
+       and (memcmp(entry.header, header, length) == 0) ) {
+    header_cache_hits++;
+    branch_code = entry.branch_code;
+    caller = entry.caller;
+    memcpy(commands.suffixes_, entry.suffixes, sizeof(entry.suffixes));
+    #if SCPI_OPTIONAL_NODES
+    commands.path_depth_ = entry.path_depth;
+    #endif
+    return entry.index;
+  }
+  header_cache_misses++;
+  uint8_t index = this->FindBranchCaller_(commands, 0, branch_code, caller);
+  memcpy(entry.header, header, length);
+  entry.length = length;
+  entry.index = index;
+  entry.branch_code = branch_code;
+  entry.caller = caller;
+  memcpy(entry.suffixes, commands.suffixes_, sizeof(entry.suffixes));
+  #if SCPI_OPTIONAL_NODES
+  entry.path_depth = commands.path_depth_;
+  #endif
+  return index;
+}
+
+///Empty the header cache, called when the registered commands change.
+template <class Config>
+void SCPI_Basic_Parser<Config>::ClearHeaderCache_() {
+  for (uint8_t i = 0; i < SCPI_HEADER_CACHE; i++) header_cache_[i].length = 0;
+}
+#endif
+
+/*!
+ Gets a message from a Stream interface and execute it.
+ @see GetMessage
+ @see Execute
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::ProcessInput(Stream& interface,
+                                             const char* term_chars) {
+  this->ProcessInput(session_, interface, term_chars);
+}
+
+/*!
+ ProcessInput version for a SCPI_Session.
+ @param session  Receive state of the interface, use one for each interface.
+ @param interface  A Stream interface like Serial or Ethernet.
+ @param term_chars  Termination chars e.g. ``"\r\n"``.
+
+ Example:  
+  ``my_instrument.ProcessInput(ethernet_session, client, "\n");``
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::ProcessInput(session_t& session,
+                                             Stream& interface,
+                                             const char* term_chars) {
+  #if SCPI_MAX_OPERATIONS
+  this->PollOperations();
+  #endif
+  #if SCPI_MAX_STREAMS
+  //New messages are read after the streamed responses are written
+  this->PollResponses();
+  if (this->StreamPending_(interface)) return;
+  #endif
+  char* message = this->GetMessage(session, interface, term_chars);
+  if (message != NULL) {
+    this->Execute(message, interface);
+  }
+}
+
+/*!
+ Gets and executes all the complete messages available in an interface.
+
+ Unlike ProcessInput, which executes one message per call, this processes
+ every message already received (e.g. pipelined commands), and returns
+ when no complete message is left.  
+ @see GetMessage
+ @see Execute
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::ProcessAllInput(Stream& interface,
+                                                const char* term_chars) {
+  this->ProcessAllInput(session_, interface, term_chars);
+}
+
+///ProcessAllInput version for a SCPI_Session.
+template <class Config>
+void SCPI_Basic_Parser<Config>::ProcessAllInput(session_t& session,
+                                                Stream& interface,
+                                                const char* term_chars) {
+  #if SCPI_MAX_OPERATIONS
+  this->PollOperations();
+  #endif
+  #if SCPI_MAX_STREAMS
+  //New messages are read after the streamed responses are written
+  this->PollResponses();
+  if (this->StreamPending_(interface)) return;
+  #endif
+  char* message = this->GetMessage(session, interface, term_chars);
+  while (message != NULL) {
+    this->Execute(message, interface);
+    #if SCPI_MAX_STREAMS
+    if (this->StreamPending_(interface)) return;
+    #endif
+    message = this->GetMessage(session, interface, term_chars);
+  }
+}
+
+/*!
+ Process received data, the complete messages are executed.
+ @param data  Received chars (not modified, e.g. a DMA or socket buffer).
+ @param length  Number of received chars.
+ @param interface  Where the responses are written.
+ @param term_chars  Termination chars e.g. ``"\r\n"``.
+ @param timestamp  Time when the data was received (``millis()``).
+
+ Push alternative to ProcessAllInput, for transports that deliver chunks
+ of data (DMA or interrupt callbacks, event loops). The chars are copied to
+ the message buffer in blocks, without reading the interface, and each 
+ message is executed as soon as its termination chars are received.  
+ A partial message older than ``timeout`` ms is discarded (Timeout error)
+ when the next data arrives, call it with ``length`` 0 to only check it.  
+ Arbitrary block parameters and special commands are not detected, they
+ need GetMessage (or ProcessInput) to read the data from the interface.  
+ A message interrupts the pending streamed responses of the interface (see
+ StreamResponse), wait until PollResponses returns true before sending the
+ next message.
+
+ Example:  
+  ``my_instrument.Feed(dma_buffer, received, Serial, "\n");``
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::Feed(const char* data, size_t length,
+                                     Stream& interface, 
+                                     const char* term_chars,
+                                     unsigned long timestamp) {
+  this->Feed(session_, data, length, interface, term_chars, timestamp);
+}
+
+///Feed version for a SCPI_Session.
+template <class Config>
+void SCPI_Basic_Parser<Config>::Feed(session_t& session, 
+                                     const char* data, size_t length,
+                                     Stream& interface, 
+                                     const char* term_chars,
+                                     unsigned long timestamp) {
+  #if SCPI_MAX_OPERATIONS
+  this->PollOperations();
+  #endif
+  #if SCPI_MAX_STREAMS
+  this->PollResponses();
+  #endif
+  //The timeout is counted from the last received chars
+  if ( (session.message_length_ > 0) 
+       and (timestamp - session.time_checker_ > timeout) ) {
+    this->SetError_(ErrorCode::Timeout);
+    this->CallErrorHandler_(interface);
+    session.message_length_ = 0;
+  }
+  if (length > 0) session.time_checker_ = timestamp;
+  size_t term_length = strlen(term_chars);
+  char term_last = term_chars[term_length - 1];
+  while (length > 0) {
+    //Copy up to the next char that may end the termination chars
+    const char* end = (const char*)memchr(data, term_last, length);
+    size_t count = (end == NULL) ? length : end - data + 1;
+    size_t space = buffer_length - 1 - session.message_length_;
+    if (count > space) {
+      //Call ErrorHandler due BufferOverflow (as GetMessage does, the chars
+      //after the one that overflows start a new message)
+      data += space + 1;
+      length -= space + 1;
+      this->SetError_(ErrorCode::BufferOverflow);
+      #if SCPI_STATISTICS
+      statistics.max_message_length = buffer_length;
+      #endif
+      this->CallErrorHandler_(interface);
+      session.message_length_ = 0;
+      continue;
+    }
+    memcpy(session.msg_buffer_ + session.message_length_, data, count);
+    session.message_length_ += count;
+    data += count;
+    length -= count;
+    if ( (end == NULL) or (session.message_length_ < term_length)
+         or (memcmp(session.msg_buffer_ + session.message_length_ 
+                    - term_length, term_chars, term_length) != 0) ) 
+      continue;
+    //Execute the received message
+    session.message_length_ -= term_length;
+    session.msg_buffer_[session.message_length_] = '\0';
+    #if SCPI_STATISTICS
+    if (session.message_length_ > statistics.max_message_length)
+      statistics.max_message_length = session.message_length_;
+    #endif
+    session.message_length_ = 0;
+    this->Execute(session.msg_buffer_, interface);
+  }
+}
+
+#if SCPI_MAX_OPERATIONS
+/*!
+ Start an overlapped operation.
+ @param operation  Procedure that returns true when the operation is
+        completed, e.g. ``bool AcquisitionDone()``.
+ @return false if there is no space for a new pending operation, the 
+ operation is not started then and the OperationIgnored error (-213, Init
+ ignored) is reported.
+
+ Call it from a command procedure that starts a slow task (e.g. a relay
+ settling or a long acquisition), then return. The parser keeps receiving 
+ and executing commands, and the operation is polled by PollOperations.  
+ ``*OPC``, ``*OPC?`` and ``*WAI`` wait for the pending operations.  
+ Max number of pending operations: ``SCPI_MAX_OPERATIONS``.
+*/
+template <class Config>
+bool SCPI_Basic_Parser<Config>::StartOperation(SCPI_operation_t operation) {
+  if (operations_size_ < max_operations) {
+    operations_[operations_size_] = operation;
+    operations_size_++;
+    return true;
+  }
+  this->SetError_(ErrorCode::OperationIgnored);
+  return false;
+}
+
+/*!
+ Poll the pending overlapped operations.
+ @return true if all the operations are completed (and nothing is queued).
+
+ The completed operations are removed. Once all of them are completed 
+ ``operation_complete`` is set (if ``*OPC`` was received) and the messages 
+ received after ``*WAI`` or ``*OPC?`` are executed (the messages of an 
+ interface with pending streamed responses wait for them).  
+ ProcessInput and ProcessAllInput call it, call it from ``loop()`` if they 
+ are not used.
+*/
+template <class Config>
+bool SCPI_Basic_Parser<Config>::PollOperations() {
+  uint8_t i = 0;
+  //operations_size_ is at most max_operations (also tells it to the compiler)
+  while ((i < operations_size_) and (i < max_operations)) {
+    if ((*operations_[i])()) {
+      operations_size_--;
+      for (uint8_t j = i; (j < operations_size_) and (j + 1 < max_operations);
+           j++) 
+        operations_[j] = operations_[j + 1];
+    } else {
+      i++;
+    }
+  }
+  if (operations_size_ > 0) return false;
+  if (opc_armed_) {
+    opc_armed_ = false;
+    operation_complete = true;
+  }
+  if (replaying_ or not waiting_) return not waiting_;
+  //Execute the queued messages, until one of them waits again
+  waiting_ = false;
+  replaying_ = true;
+  char message[Config::buffer_length];
+  while ((wait_queue_size_ > 0) and not waiting_) {
+    Stream* interface;
+    memcpy(&interface, wait_queue_, sizeof(interface));
+    #if SCPI_MAX_STREAMS
+    //The next messages of an interface wait for its streamed responses
+    if (this->StreamPending_(*interface)) {
+      waiting_ = true;
+      break;
+    }
+    #endif
+    header_path path;
+    memcpy(&path, wait_queue_ + sizeof(interface), sizeof(path));
+    strcpy(message, wait_queue_ + sizeof(interface) + sizeof(path));
+    uint16_t entry_length = sizeof(interface) + sizeof(path) 
+                            + strlen(message) + 1;
+    wait_queue_size_ -= entry_length;
+    memmove(wait_queue_, wait_queue_ + entry_length, wait_queue_size_);
+    this->Execute_(message, *interface, path);
+  }
+  replaying_ = false;
+  return not waiting_;
+}
+
+///Identify *OPC (1), *OPC? (2) and *WAI (3), return 0 for other headers.
+template <class Config>
+uint8_t SCPI_Basic_Parser<Config>::SyncCommand_(const char* header) {
+  if (strcasecmp(header, "*OPC") == 0) return 1;
+  if (strcasecmp(header, "*OPC?") == 0) return 2;
+  if (strcasecmp(header, "*WAI") == 0) return 3;
+  return 0;
+}
+
+/*!
+ Store a message until the pending operations are completed.
+ @param unit  First message unit, or NULL.
+ @param message  Rest of the message, or NULL.
+ @param interface  The source of the message.
+ @param path  Header path of the message's first unit.
+ @return false if the message does not fit in the queue.
+
+ The message is added at the end of the queue, or at the start while the 
+ queued messages are executed (so the order is kept). The header path is
+ stored with it, so the relative headers of the queued units still follow 
+ the units executed before the wait.  
+ If it does not fit, the error handler is called (BufferOverflow error).
+*/
+template <class Config>
+bool SCPI_Basic_Parser<Config>::QueueMessage_(const char* unit,
+                                              const char* message,
+                                              Stream& interface,
+                                              const header_path& path) {
+  size_t unit_length = (unit == NULL) ? 0 : strlen(unit);
+  size_t message_length = (message == NULL) ? 0 : strlen(message);
+  size_t text_length = unit_length + message_length 
+                       + ((unit != NULL) and (message != NULL));
+  size_t entry_length = sizeof(Stream*) + sizeof(path) + text_length + 1;
+  if ( (text_length >= buffer_length) 
+       or (wait_queue_size_ + entry_length > wait_queue_length) ) {
+    this->SetError_(ErrorCode::BufferOverflow);
+    this->CallErrorHandler_(interface);
+    return false;
+  }
+  char* entry = wait_queue_ + wait_queue_size_;
+  if (replaying_) {
+    memmove(wait_queue_ + entry_length, wait_queue_, wait_queue_size_);
+    entry = wait_queue_;
+  }
+  Stream* source = &interface;
+  memcpy(entry, &source, sizeof(source));
+  memcpy(entry + sizeof(source), &path, sizeof(path));
+  char* text = entry + sizeof(source) + sizeof(path);
+  if (unit != NULL) {
+    memcpy(text, unit, unit_length);
+    text += unit_length;
+    if (message != NULL) *text++ = ';';
+  }
+  if (message != NULL) {
+    memcpy(text, message, message_length);
+    text += message_length;
+  }
+  text[0] = '\0';
+  wait_queue_size_ += entry_length;
+  return true;
+}
+#endif
+
+#if SCPI_MAX_STREAMS
+/*!
+ Start a streamed response.
+ @param interface  The interface passed to the command procedure.
+ @param producer  Procedure that copies the response data to a buffer, 
+        e.g. ``size_t ReadTrace(char* buffer, size_t size, uint32_t position)``.
+ @param length  Number of chars of data, or 0 if the data ends when the 
+        producer returns 0.
+ @param block  Send the data as an IEEE 488.2 arbitrary block, 
+        ``#<n><length><data>`` (or ``#0<data>`` if ``length`` is 0).
+ @return false if there are already ``SCPI_MAX_STREAMS`` pending streamed 
+ responses, nothing is written then (the procedure should report an error, 
+ e.g. with PushError).
+
+ Call it from a query procedure that returns a large amount of data (e.g. 
+ ``TRACe:DATA?``), then return. The response is not built in RAM, 
+ PollResponses requests it to the producer in chunks of up to 
+ ``SCPI_STREAM_CHUNK_LENGTH`` chars, and writes only what the interface 
+ accepts without blocking (``availableForWrite``), so the parser keeps 
+ serving the other interfaces. The response is terminated with a '\\n'.  
+ Interfaces that do not report their free space (``availableForWrite`` 
+ returns 0 when the response starts) are written with blocking writes, 
+ all the data the producer has ready on each poll.  
+ When ``length`` is not 0, the producer can return 0 if the data is not 
+ ready yet, it is called again on the next poll.  
+ ProcessInput and ProcessAllInput read the next messages of the interface
+ after its pending streamed responses. A message executed before (e.g. 
+ with Feed or Execute) interrupts them: they are terminated with a '\\n' 
+ and the QueryInterrupted error is reported.  
+ The streamed response is written after the responses of the current 
+ message, so it should be the last query of the message.  
+ Max number of pending streamed responses: ``SCPI_MAX_STREAMS``.
+*/
+template <class Config>
+bool SCPI_Basic_Parser<Config>::StreamResponse(Stream& interface, 
+                                               SCPI_producer_t producer,
+                                               uint32_t length, 
+                                               bool block) {
+  stream_entry entry;
+  entry.interface = &interface;
+  entry.producer = producer;
+  entry.length = length;
+  entry.position = 0;
+  entry.header_length = 0;
+  entry.header_sent = 0;
+  entry.data_ended = false;
+  entry.blocking = (interface.availableForWrite() <= 0);
+  if (block) {
+    //"#<number of digits><length>", or "#0" for an unknown length
+    uint8_t count = 0;
+    for (uint32_t rest = length; rest > 0; rest /= 10) count++;
+    entry.header[0] = '#';
+    entry.header[1] = '0' + count;
+    uint32_t rest = length;
+    for (uint8_t i = count + 1; i > 1; i--) {
+      entry.header[i] = '0' + rest % 10;
+      rest /= 10;
+    }
+    entry.header_length = 2 + count;
+  }
+  if (streams_size_ == max_streams) return false;
+  streams_[streams_size_] = entry;
+  streams_size_++;
+  return true;
+}
+
+/*!
+ Write the pending streamed responses.
+ @return true if all the streamed responses are completed.
+
+ Only the oldest pending response of each interface is written, up to the
+ interface's ``availableForWrite`` chars. The completed ones are removed.  
+ ProcessInput, ProcessAllInput and Feed call it, call it from ``loop()`` if 
+ they are not used.
+*/
+template <class Config>
+bool SCPI_Basic_Parser<Config>::PollResponses() {
+  uint8_t i = 0;
+  //streams_size_ is at most max_streams (also tells it to the compiler)
+  while ((i < streams_size_) and (i < max_streams)) {
+    bool oldest = true;
+    for (uint8_t j = 0; j < i; j++) 
+      if (streams_[j].interface == streams_[i].interface) oldest = false;
+    if (oldest and this->WriteResponse_(streams_[i])) {
+      streams_size_--;
+      for (uint8_t j = i; (j < streams_size_) and (j + 1 < max_streams); j++) 
+        streams_[j] = streams_[j + 1];
+    } else {
+      i++;
+    }
+  }
+  return (streams_size_ == 0);
+}
+
+/*!
+ Write a streamed response, as much as the interface accepts.
+ @return true if the response is completed.
+
+ Blocking entries are written until the producer has no data ready (or the
+ response is completed).
+*/
+template <class Config>
+bool SCPI_Basic_Parser<Config>::WriteResponse_(stream_entry& entry) {
+  Stream& interface = *entry.interface;
+  int space = entry.blocking ? SCPI_STREAM_CHUNK_LENGTH 
+                             : interface.availableForWrite();
+  while (space > 0) {
+    if (entry.header_sent < entry.header_length) {
+      size_t count = entry.header_length - entry.header_sent;
+      if (count > size_t(space)) count = space;
+      count = interface.write((const uint8_t*)entry.header 
+                              + entry.header_sent, count);
+      if (count == 0) return false;
+      entry.header_sent += count;
+      if (not entry.blocking) space -= count;
+    } else if (not entry.data_ended) {
+      char chunk[SCPI_STREAM_CHUNK_LENGTH];
+      size_t size = (size_t(space) < sizeof(chunk)) ? space : sizeof(chunk);
+      uint32_t remaining = entry.length - entry.position;
+      if ((entry.length > 0) and (remaining < size)) size = remaining;
+      size_t count = (size > 0) 
+                     ? (*entry.producer)(chunk, size, entry.position) : 0;
+      if (count > size) count = size;
+      if (count == 0) {
+        //Data not ready yet
+        if (entry.position < entry.length) return false;
+        entry.data_ended = true;
+        continue;
+      }
+      interface.write((const uint8_t*)chunk, count);
+      entry.position += count;
+      if (not entry.blocking) space -= count;
+    } else {
+      interface.write('\n');
+      return true;
+    }
+  }
+  return false;
+}
+
+///True if there is a pending streamed response for the interface.
+template <class Config>
+bool SCPI_Basic_Parser<Config>::StreamPending_(Stream& interface) {
+  for (uint8_t i = 0; i < streams_size_; i++)
+    if (streams_[i].interface == &interface) return true;
+  return false;
+}
+
+/*!
+ Terminate and remove the pending streamed responses of an interface.
+
+ The responses already started are terminated with a '\\n', the data not 
+ written yet is discarded.
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::InterruptResponses_(Stream& interface) {
+  uint8_t i = 0;
+  while ((i < streams_size_) and (i < max_streams)) {
+    stream_entry& entry = streams_[i];
+    if (entry.interface != &interface) {
+      i++;
+      continue;
+    }
+    if ((entry.header_sent > 0) or (entry.position > 0)) 
+      interface.write('\n');
+    streams_size_--;
+    for (uint8_t j = i; (j < streams_size_) and (j + 1 < max_streams); j++) 
+      streams_[j] = streams_[j + 1];
+  }
+}
+
+/*!
+ Move the streamed responses started with a wrapper of an interface (e.g. a
+ SCPI_Response) to the interface, as the wrapper is destroyed afterwards.
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::RetargetResponses_(Stream& wrapper, 
+                                                   Stream& interface) {
+  for (uint8_t i = 0; i < streams_size_; i++) {
+    if (streams_[i].interface != &wrapper) continue;
+    streams_[i].interface = &interface;
+    streams_[i].blocking = (interface.availableForWrite() <= 0);
+  }
+}
+#endif
+
+/*!
+ Decode a numeric parameter (NR1, NR2 or NR3) without using floats.  
+ @param text  Parameter to decode, e.g. ``"-1.5e3"`` or ``"10 mV"``.
+ @param unit  Valid unit (e.g. ``"V"``), or NULL if no suffix is allowed.
+ @param mantissa[out]  Decoded digits.
+ @param exponent[out]  Decimal exponent, including the suffix multiplier.
+ @param negative[out]  The number is negative.
+ @return false if the text is not a valid number.
+
+ The value is ``mantissa * 10^exponent``, only the first 9 or 10 significant 
+ digits are kept.  
+ The suffix is the unit with an optional multiplier (EX, PE, T, G, MA, K, M, 
+ U, N, P, F or A), case insensitive. M means mega for HZ and OHM units.
+*/
+template <class Config>
+bool SCPI_Basic_Parser<Config>::DecodeNumber_(const char* text,
+                                              const char* unit,
+                                              uint32_t& mantissa,
+                                              int16_t& exponent,
+                                              bool& negative) {
+  mantissa = 0;
+  exponent = 0;
+  negative = (text[0] == '-');
+  if ((text[0] == '-') or (text[0] == '+')) text++;
+  bool digits = false;
+  bool fraction = false;
+  for (; ; text++) {
+    if (isdigit(text[0])) {
+      digits = true;
+      if (mantissa < 429496729) {
+        mantissa = mantissa * 10 + (text[0] - '0');
+        if (fraction) exponent--;
+      } else if (not fraction) {
+        //Not significant digit
+        exponent++;
+      }
+    } else if ((text[0] == '.') and not fraction) {
+      fraction = true;
+    } else {
+      break;
+    }
+  }
+  if (not digits) return false;
+
+  //Exponent (NR3), an 'E' not followed by digits starts the suffix (EX)
+  if ((text[0] == 'e') or (text[0] == 'E')) {
+    const char* exponent_text = text + 1;
+    bool negative_exponent = (exponent_text[0] == '-');
+    if ((exponent_text[0] == '-') or (exponent_text[0] == '+')) 
+      exponent_text++;
+    if (isdigit(exponent_text[0])) {
+      int16_t value = 0;
+      for (; isdigit(exponent_text[0]); exponent_text++)
+        if (value < 1000) value = value * 10 + (exponent_text[0] - '0');
+      exponent += negative_exponent ? -value : value;
+      text = exponent_text;
+    }
+  }
+
+  //Suffix (unit with optional multiplier)
+  while (isspace(text[0])) text++;
+  size_t suffix_length = strlen(text);
+  if (suffix_length == 0) return true;
+  if (unit == NULL) return false;
+  size_t unit_length = strlen(unit);
+  if (suffix_length < unit_length) return false;
+  size_t prefix_length = suffix_length - unit_length;
+  for (size_t i = 0; i < unit_length; i++)
+    if (toupper(text[prefix_length + i]) != toupper(unit[i])) return false;
+  if (prefix_length == 0) return true;
+  if (prefix_length > 2) return false;
+  char first = toupper(text[0]);
+  char second = (prefix_length == 2) ? toupper(text[1]) : '\0';
+  if (second != '\0') {
+    if ((first == 'E') and (second == 'X')) exponent += 18;
+    else if ((first == 'P') and (second == 'E')) exponent += 15;
+    else if ((first == 'M') and (second == 'A')) exponent += 6;
+    else return false;
+    return true;
+  }
+  switch (first) {
+    case 'T': exponent += 12; break;
+    case 'G': exponent += 9; break;
+    case 'K': exponent += 3; break;
+    case 'M': 
+      //Mega for HZ and OHM units, milli for the others
+      if ( ( (unit_length == 2) and (toupper(unit[0]) == 'H') 
+             and (toupper(unit[1]) == 'Z') )
+           or ( (unit_length == 3) and (toupper(unit[0]) == 'O')
+                and (toupper(unit[1]) == 'H') and (toupper(unit[2]) == 'M') ) )
+        exponent += 6;
+      else 
+        exponent -= 3;
+      break;
+    case 'U': exponent -= 6; break;
+    case 'N': exponent -= 9; break;
+    case 'P': exponent -= 12; break;
+    case 'F': exponent -= 15; break;
+    case 'A': exponent -= 18; break;
+    default: return false;
+  }
+  return true;
+}
+
+/*!
+ Compare a parameter with a keyword, case insensitive.  
+ @param text  Parameter to compare.
+ @param keyword  Keyword, ending at a null char or '|'. The upper case part 
+ is its short form (e.g. ``"MINimum"`` matches ``"min"`` and ``"MINIMUM"``).
+ @return true if the parameter is the short or the long form of the keyword.
+*/
+template <class Config>
+bool SCPI_Basic_Parser<Config>::MatchParameterKeyword_(const char* text, 
+                                                       const char* keyword) {
+  //Keywords are ASCII, lower case chars are compared as upper case
+  uint8_t short_length = 0;
+  uint8_t length = 0;
+  for (; text[length] != '\0'; length++) {
+    char keyword_char = keyword[length];
+    if ((keyword_char == '\0') or (keyword_char == '|')) return false;
+    bool lower = (keyword_char >= 'a') and (keyword_char <= 'z');
+    if (lower) keyword_char -= 'a' - 'A';
+    else if (short_length == length) short_length++;
+    char text_char = text[length];
+    if ((text_char >= 'a') and (text_char <= 'z')) text_char -= 'a' - 'A';
+    if (text_char != keyword_char) return false;
+  }
+  //Long form (the whole keyword) or short form (all the upper case chars)
+  char next_char = keyword[length];
+  if ((next_char == '\0') or (next_char == '|')) return true;
+  return (length == short_length) 
+         and ((next_char >= 'a') and (next_char <= 'z'));
+}
+
+/*!
+ Get the text of a parameter.  
+ @return The parameter, or NULL if it is missing (MissingParameter error).
+*/
+template <class Config>
+char* SCPI_Basic_Parser<Config>::GetParameter_(const SCPI_P& parameters,
+                                               uint8_t index,
+                                               Stream& interface) {
+  char* text = parameters[index];
+  if (text == NULL) 
+    this->ParameterError_(ErrorCode::MissingParameter, parameters, interface);
+  return text;
+}
+
+/*!
+ Set last_error and call the error handler, always return false.
+ @param context  The parameter (queued with the error), or NULL.
+*/
+template <class Config>
+bool SCPI_Basic_Parser<Config>::ParameterError_(ErrorCode error,
+                                                const SCPI_P& parameters,
+                                                Stream& interface,
+                                                const char* context) {
+  this->SetError_(error, context);
+  this->CallErrorHandler_(interface, parameters);
+  return false;
+}
+
+/*!
+ Set last_error.
+ @param context  Context of the error (e.g. the header), or NULL.
+ @param context_end  End of the context, NULL if it is null terminated.
+
+ The errors are counted if SCPI_STATISTICS is enabled, and queued (with 
+ their SCPI error code) if SCPI_ERROR_QUEUE_LENGTH is greater than 0.
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::SetError_(ErrorCode error, 
+                                          const char* context,
+                                          const char* context_end) {
+  last_error = error;
+  #if SCPI_STATISTICS
+  statistics.errors[uint8_t(error)]++;
+  #endif
+  #if SCPI_ERROR_QUEUE_LENGTH
+  this->PushError_(ScpiErrorCode_(error), context, context_end);
+  #else
+  (void)context; //Only stored in the error queue
+  (void)context_end;
+  #endif
+}
+
+#if SCPI_ERROR_QUEUE_LENGTH
+///SCPI-99 error code of an ErrorCode.
+template <class Config>
+int16_t SCPI_Basic_Parser<Config>::ScpiErrorCode_(ErrorCode error) {
+  switch (error) {
+    case ErrorCode::UnknownCommand: return -113;
+    case ErrorCode::Timeout: return -365;
+    case ErrorCode::BufferOverflow: return -363;
+    case ErrorCode::MissingParameter: return -109;
+    case ErrorCode::InvalidParameter: return -104;
+    case ErrorCode::OutOfRange: return -222;
+    case ErrorCode::QueryInterrupted: return -410;
+    case ErrorCode::OperationIgnored: return -213;
+    default: return 0;
+  }
+}
+
+/*!
+ Add an error to the error queue.
+ @param code  Error code, negative codes are reserved by SCPI-99, positive
+        codes are device-specific errors.
+ @param context  Optional text of the error (up to SCPI_ERROR_CONTEXT_LENGTH
+        chars are stored), e.g. the value that caused it.
+
+ The errors are read in order (oldest first) with PrintNextError. If the queue is full, its last error is replaced by
+ -350 (Queue overflow) and the new errors are discarded until there is room.
+
+ Example:  
+  ``my_instrument.PushError(201, "Over temperature");``
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::PushError(int16_t code, const char* context) {
+  this->PushError_(code, context, NULL);
+}
+
+///PushError version for a context that ends at context_end.
+template <class Config>
+void SCPI_Basic_Parser<Config>::PushError_(int16_t code, const char* context,
+                                           const char* context_end) {
+  if (code == 0) return;
+  uint16_t position = error_queue_start_ + error_queue_size_;
+  if (error_queue_size_ == SCPI_ERROR_QUEUE_LENGTH) {
+    //Queue overflow, the errors received until there is room are lost
+    error_entry& last = error_queue_[(position - 1) % SCPI_ERROR_QUEUE_LENGTH];
+    last.code = -350;
+    #if SCPI_ERROR_CONTEXT_LENGTH
+    last.context[0] = '\0';
+    #endif
+    return;
+  }
+  error_entry& entry = error_queue_[position % SCPI_ERROR_QUEUE_LENGTH];
+  error_queue_size_++;
+  entry.code = code;
+  #if SCPI_ERROR_CONTEXT_LENGTH
+  //Tokens split by SCPI_Commands are separated by '\0', printed as ':'
+  uint8_t length = 0;
+  if (context != NULL) {
+    for (; length < SCPI_ERROR_CONTEXT_LENGTH; length++) {
+      if ((context_end == NULL) ? (context[length] == '\0') 
+                                : (context + length >= context_end)) break;
+      entry.context[length] = (context[length] == '\0') ? ':' 
+                                                         : context[length];
+    }
+  }
+  entry.context[length] = '\0';
+  #else
+  (void)context; //Only stored if SCPI_ERROR_CONTEXT_LENGTH > 0
+  (void)context_end;
+  #endif
+}
+
+/*!
+ Remove the oldest error from the error queue and print it.
+ @param interface  Where the error is printed.
+
+ The error is printed in the SCPI format, e.g. ``-113,"Undefined header;FOO"``
+ (the context is added after the ';'), or ``0,"No error"`` if the queue is
+ empty.
+ Call it from the procedure of the SCPI required ``SYSTem:ERRor[:NEXT]?`` 
+ query.
+
+ Example:  
+  ``void GetError(SCPI_C commands, SCPI_P parameters, Stream& interface) {``  
+  ``  my_instrument.PrintNextError(interface);``  
+  ``}``
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::PrintNextError(Stream& interface) {
+  error_entry entry;
+  entry.code = 0;
+  #if SCPI_ERROR_CONTEXT_LENGTH
+  entry.context[0] = '\0';
+  #endif
+  if (error_queue_size_ > 0) {
+    entry = error_queue_[error_queue_start_];
+    error_queue_start_ = (error_queue_start_ + 1) % SCPI_ERROR_QUEUE_LENGTH;
+    error_queue_size_--;
+  }
+  interface.print(entry.code);
+  interface.print(F(",\""));
+  #if SCPI_ERROR_CONTEXT_LENGTH
+  bool described = true;
+  #endif
+  switch (entry.code) {
+    case 0: interface.print(F("No error")); break;
+    case -104: interface.print(F("Data type error")); break;
+    case -109: interface.print(F("Missing parameter")); break;
+    case -113: interface.print(F("Undefined header")); break;
+    case -213: interface.print(F("Init ignored")); break;
+    case -222: interface.print(F("Data out of range")); break;
+    case -223: interface.print(F("Too much data")); break;
+    case -350: interface.print(F("Queue overflow")); break;
+    case -363: interface.print(F("Input buffer overrun")); break;
+    case -365: interface.print(F("Time out error")); break;
+    case -410: interface.print(F("Query INTERRUPTED")); break;
+    default:
+      #if SCPI_ERROR_CONTEXT_LENGTH
+      described = false;
+      #endif
+      break;
+  }
+  #if SCPI_ERROR_CONTEXT_LENGTH
+  if (entry.context[0] != '\0') {
+    if (described) interface.print(';');
+    interface.print(entry.context);
+  }
+  #endif
+  interface.println('"');
+}
+
+///Empty the error queue.
+template <class Config>
+void SCPI_Basic_Parser<Config>::ClearErrors() {
+  error_queue_start_ = 0;
+  error_queue_size_ = 0;
+}
+#endif
+
+/*!
+ Call the procedure of a command.
+ @param index  Index of the command (as returned by FindCaller_).
+ @param caller  Procedure of the command (NULL for procedures with a context).
+
+ Procedures with a context get the commands and parameters by reference, the
+ other ones get a copy.
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::Call_(uint8_t index, SCPI_caller_t caller,
+                                      const SCPI_C& commands,
+                                      const SCPI_P& parameters,
+                                      Stream& interface) {
+  #if SCPI_HANDLER_CONTEXT
+  if ((index <= max_commands) and (context_callers_[index] != NULL)) {
+    (*context_callers_[index])(commands, parameters, interface, 
+                               contexts_[index]);
+    return;
+  }
+  #else
+  (void)index; //Only used to find the context
+  #endif
+  (*caller)(commands, parameters, interface);
+}
+
+/*!
+ Call the ErrorHandler, after an error is set (see SetError_).
+ @param parameters  Parameters of the command that raised the error, if any.
+
+ Used for the errors raised outside of the message units (e.g. Timeout and
+ BufferOverflow while receiving) and by the parameter decoders. With 
+ SCPI_STATISTICS the call is added to the ErrorHandler statistics.
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::CallErrorHandler_(Stream& interface,
+                                                  const SCPI_P& parameters) {
+  #if SCPI_STATISTICS
+  unsigned long start = micros();
+  #endif
+  this->Call_(max_commands, callers_[max_commands], SCPI_C(), parameters,
+              interface);
+  #if SCPI_STATISTICS
+  uint32_t time = micros() - start;
+  command_statistics& command_stats = command_stats_[max_commands];
+  command_stats.calls++;
+  command_stats.total_time += time;
+  if (time > command_stats.max_time) command_stats.max_time = time;
+  #endif
+}
+
+/*!
+ Decode an integer parameter.  
+ @param parameters  Parameters of the command.
+ @param index  Index of the parameter to decode.
+ @param value[in,out]  Default value (used for ``DEFault``), decoded value.
+ @param min_value  Minimum valid value (used for ``MINimum``).
+ @param max_value  Maximum valid value (used for ``MAXimum``).
+ @param interface  Interface used to report errors.
+ @return true if the value was decoded.
+
+ Decimal numbers are accepted and rounded, only integer arithmetic is used.
+ On errors (MissingParameter, InvalidParameter or OutOfRange) the error 
+ handler is called and value is not changed.
+*/
+template <class Config>
+bool SCPI_Basic_Parser<Config>::GetInteger(const SCPI_P& parameters,
+                                           uint8_t index, long& value,
+                                           long min_value, long max_value,
+                                           Stream& interface) {
+  char* text = this->GetParameter_(parameters, index, interface);
+  if (text == NULL) return false;
+  if (isalpha(text[0])) {
+    if (MatchParameterKeyword_(text, "MINimum")) {
+      value = min_value;
+      return true;
+    }
+    if (MatchParameterKeyword_(text, "MAXimum")) {
+      value = max_value;
+      return true;
+    }
+    if (MatchParameterKeyword_(text, "DEFault")) return true;
+  }
+  uint32_t mantissa;
+  int16_t exponent;
+  bool negative;
+  if (not DecodeNumber_(text, NULL, mantissa, exponent, negative))
+    return this->ParameterError_(ErrorCode::InvalidParameter, parameters, 
+                                 interface, text);
+  if (exponent < -9) {
+    mantissa = 0;
+  } else if (exponent < 0) {
+    //Round half away from zero
+    uint32_t divisor = 1;
+    for (; exponent < 0; exponent++) divisor *= 10;
+    uint32_t remainder = mantissa % divisor;
+    mantissa /= divisor;
+    if (remainder >= divisor - remainder) mantissa++;
+  }
+  for (; (exponent > 0) and (mantissa != 0); exponent--) {
+    if (mantissa > 429496729) break;
+    mantissa *= 10;
+  }
+  if ( ((exponent > 0) and (mantissa != 0))
+       or (mantissa > (negative ? 2147483648UL : 2147483647UL)) )
+    return this->ParameterError_(ErrorCode::OutOfRange, parameters, 
+                                 interface, text);
+  if (mantissa == 0) negative = false;
+  long decoded = negative ? -long(mantissa - 1) - 1 : long(mantissa);
+  if ((decoded < min_value) or (decoded > max_value))
+    return this->ParameterError_(ErrorCode::OutOfRange, parameters, 
+                                 interface, text);
+  value = decoded;
+  return true;
+}
+
+/*!
+ Decode a real number parameter.  
+ @param parameters  Parameters of the command.
+ @param index  Index of the parameter to decode.
+ @param value[in,out]  Default value (used for ``DEFault``), decoded value.
+ @param min_value  Minimum valid value (used for ``MINimum``).
+ @param max_value  Maximum valid value (used for ``MAXimum``).
+ @param unit  Unit of the value (e.g. ``"V"`` accepts ``"5mV"``), or NULL.
+ @param interface  Interface used to report errors.
+ @return true if the value was decoded.
+
+ On errors (MissingParameter, InvalidParameter or OutOfRange) the error 
+ handler is called and value is not changed.
+*/
+template <class Config>
+bool SCPI_Basic_Parser<Config>::GetReal(const SCPI_P& parameters, uint8_t index,
+                                        float& value, float min_value,
+                                        float max_value, const char* unit,
+                                        Stream& interface) {
+  char* text = this->GetParameter_(parameters, index, interface);
+  if (text == NULL) return false;
+  if (isalpha(text[0])) {
+    if (MatchParameterKeyword_(text, "MINimum")) {
+      value = min_value;
+      return true;
+    }
+    if (MatchParameterKeyword_(text, "MAXimum")) {
+      value = max_value;
+      return true;
+    }
+    if (MatchParameterKeyword_(text, "DEFault")) return true;
+  }
+  uint32_t mantissa;
+  int16_t exponent;
+  bool negative;
+  if (not DecodeNumber_(text, unit, mantissa, exponent, negative))
+    return this->ParameterError_(ErrorCode::InvalidParameter, parameters, 
+                                 interface, text);
+  //Integers are converted directly, other values are scaled by 10^exponent
+  double decoded = mantissa;
+  if ((exponent != 0) and (mantissa != 0)) {
+    uint16_t power = (exponent < 0) ? -exponent : exponent;
+    if (power > 63) {
+      if (exponent > 0) 
+        return this->ParameterError_(ErrorCode::OutOfRange, parameters, 
+                                     interface, text);
+      decoded = 0;
+    } else {
+      double scale = 1;
+      for (double factor = 10; power != 0; power >>= 1, factor *= factor)
+        if (power & 1) scale *= factor;
+      decoded = (exponent > 0) ? decoded * scale : decoded / scale;
+    }
+  }
+  if (negative) decoded = -decoded;
+  if ((decoded < min_value) or (decoded > max_value))
+    return this->ParameterError_(ErrorCode::OutOfRange, parameters, 
+                                 interface, text);
+  value = decoded;
+  return true;
+}
+
+/*!
+ Decode a boolean parameter.  
+ @param parameters  Parameters of the command.
+ @param index  Index of the parameter to decode.
+ @param value[out]  Decoded value.
+ @param interface  Interface used to report errors.
+ @return true if the value was decoded.
+
+ Valid values are ``ON``, ``OFF`` and numbers (false if they round to 0).
+ On errors (MissingParameter or InvalidParameter) the error handler is 
+ called and value is not changed.
+*/
+template <class Config>
+bool SCPI_Basic_Parser<Config>::GetBoolean(const SCPI_P& parameters,
+                                           uint8_t index, bool& value,
+                                           Stream& interface) {
+  char* text = this->GetParameter_(parameters, index, interface);
+  if (text == NULL) return false;
+  if (MatchParameterKeyword_(text, "ON")) {
+    value = true;
+    return true;
+  }
+  if (MatchParameterKeyword_(text, "OFF")) {
+    value = false;
+    return true;
+  }
+  uint32_t mantissa;
+  int16_t exponent;
+  bool negative;
+  if (not DecodeNumber_(text, NULL, mantissa, exponent, negative))
+    return this->ParameterError_(ErrorCode::InvalidParameter, parameters, 
+                                 interface, text);
+  //Values below 0.5 round to 0
+  if (exponent < 0) {
+    uint32_t half = 5;
+    for (int16_t i = exponent + 1; (i < 0) and (half != 0); i++) {
+      if (half > 429496729) half = 0;
+      else half *= 10;
+    }
+    value = (half != 0) and (mantissa >= half);
+  } else {
+    value = (mantissa != 0);
+  }
+  return true;
 }
 
 /*!
- Get a hash from a valid command
- @param commands  Keywords of a command
- @return hash
+ Decode a parameter from a list of choices (character data).  
+ @param parameters  Parameters of the command.
+ @param index  Index of the parameter to decode.
+ @param choices  Valid keywords, separated by '|' (e.g. ``"BUS|IMMediate"``).
+ @param value[out]  Index of the received choice.
+ @param interface  Interface used to report errors.
+ @return true if the value was decoded.
 
- Return ``unknown_hash`` if the command contains  
- keywords not registered as tokens.  
- The hash is calculated including the TreeBase hash.  
- @see SetCommandTreeBase
+ On errors (MissingParameter or InvalidParameter) the error handler is 
+ called and value is not changed.
 */
-scpi_hash_t SCPI_Parser::GetCommandCode_(SCPI_Commands& commands) {
-  if (tree_code_ == invalid_hash) return invalid_hash;
-  scpi_hash_t code;
-  code = (tree_code_ == 0) ? hash_magic_offset : tree_code_;
-  if (commands.Size()==0) return unknown_hash;
-  //Loop all keywords in the command
-  for (uint8_t i = 0; i < commands.Size(); i++) {
-    //Get keywords's length
-    size_t header_length = strlen(commands[i]);
-    //For the last keyword remove the query symbol if needed
-    bool is_query = false;
-    if (i == commands.Size() - 1) {
-      is_query = (commands[i][header_length - 1] == '?');
-      if (is_query) header_length--;
+template <class Config>
+bool SCPI_Basic_Parser<Config>::GetChoice(const SCPI_P& parameters,
+                                          uint8_t index, const char* choices,
+                                          uint8_t& value, Stream& interface) {
+  char* text = this->GetParameter_(parameters, index, interface);
+  if (text == NULL) return false;
+  const char* keyword = choices;
+  for (uint8_t choice = 0; keyword != NULL; choice++) {
+    if (MatchParameterKeyword_(text, keyword)) {
+      value = choice;
+      return true;
     }
+    keyword = strchr(keyword, '|');
+    if (keyword != NULL) keyword++;
+  }
+  return this->ParameterError_(ErrorCode::InvalidParameter, parameters, 
+                               interface, text);
+}
 
-    //Loop over all the known tokens
-    for (uint8_t j = 0; j < tokens_size_; j++) {
-      //Get the token's short and long lengths
-      size_t short_length = 0;
-      while (isupper(tokens_[j][short_length])) short_length++;
-      size_t long_length = strlen(tokens_[j]);
+#if SCPI_RECEIVE_BUFFER_LENGTH or SCPI_BLOCK_DATA
+///Number of received chars (receive buffer and interface).
+int SCPI_Session_State::AvailableInput_(Stream& interface) {
+  #if SCPI_RECEIVE_BUFFER_LENGTH
+  return receive_size_ + interface.available();
+  #else
+  return interface.available();
+  #endif
+}
 
-      //If the token allows numeric suffixes
-      //remove the trailing digits from the keyword
-      if ( (tokens_[j][long_length - 1] == '#')
-         and (commands[i][header_length - 1] != '#') ) {
-        long_length--;
-        while (isdigit(commands[i][header_length - 1])) header_length--;
-      }
+///Read a received char, the receive buffer is read first.
+int SCPI_Session_State::ReadInput_(Stream& interface) {
+  #if SCPI_RECEIVE_BUFFER_LENGTH
+  if (receive_size_ > 0) {
+    char c = receive_buffer_[receive_start_];
+    if (++receive_start_ == receive_buffer_length) receive_start_ = 0;
+    receive_size_--;
+    return (unsigned char)c;
+  }
+  #endif
+  return interface.read();
+}
 
-      //Test if the keyword match with the token
-      //otherwise test next token
-      if (header_length == short_length) {
-        for (uint8_t k  = 0; k < short_length; k++)
-          if (not (toupper(commands[i][k]) == tokens_[j][k]))
-            goto no_header_token_match;
-      } else if (header_length == long_length) {
-        for (uint8_t k  = 0; k < long_length; k++)
-          if (not (toupper(commands[i][k]) == toupper(tokens_[j][k])))
-            goto no_header_token_match;
-      } else {
-            goto no_header_token_match;
-      }
+///Peek a received char, the receive buffer is read first.
+int SCPI_Session_State::PeekInput_(Stream& interface) {
+  #if SCPI_RECEIVE_BUFFER_LENGTH
+  if (receive_size_ > 0) 
+    return (unsigned char)receive_buffer_[receive_start_];
+  #endif
+  return interface.peek();
+}
+#endif
 
-      //Apply the hashing step using token number j
-      //hash(i) = hash(i - 1) * hash_magic_number + j
-      code *= hash_magic_number;
-      code += j;
-      break;
+#if SCPI_BLOCK_DATA
+/*!
+ Track the syntax of the message being received.
+ @param new_char  Last received char (already stored in msg_buffer_).
+ @return true if the char completes a block header (``#<n><length>`` or
+ ``#0``) found at the start of a parameter.
 
-      no_header_token_match:;
-      //If the keyword does not match any token return unknown_hash
-      if (j == (tokens_size_ - 1)) return unknown_hash;
+ Quoted strings, message unit separators (``;``), the header and the
+ parameter separators (``,``) are tracked, one char at a time.
+*/
+bool SCPI_Session_State::ScanBlockHeader_(char new_char) {
+  if (message_length_ == 1) {
+    unit_start_ = 0;
+    unit_state_ = 0;
+    quote_ = '\0';
+    parameter_start_ = false;
+    block_state_ = -2;
+  }
+  //Fast path, chars above '\'' (except ',' and ';') are not special
+  if ( (new_char > '\'') and (new_char != ',') and (new_char != ';') 
+       and (block_state_ == -2) and (quote_ == '\0') ) {
+    if (unit_state_ == 0) unit_state_ = 1;
+    parameter_start_ = false;
+    return false;
+  }
+  //Block header
+  if (block_state_ == -1) {
+    block_length_ = 0;
+    if (new_char == '0') {
+      block_state_ = -2;
+      return true;
     }
-    //If last keyword is a query, add a hashing step
-    if (is_query) {
-      code *= hash_magic_number;
-      code -= 1;
+    if ((new_char > '0') and (new_char <= '9')) {
+      block_state_ = new_char - '0';
+      return false;
     }
+    //Not a block (e.g. #H1F), continue as a normal parameter
+    block_state_ = -2;
+  } else if (block_state_ > 0) {
+    if (isdigit(new_char)) {
+      block_length_ = block_length_ * 10 + (new_char - '0');
+      block_state_--;
+      if (block_state_ == 0) {
+        block_state_ = -2;
+        return true;
+      }
+      return false;
+    }
+    block_state_ = -2;
   }
-  return code;
+  //Quoted strings
+  if (quote_ != '\0') {
+    if (new_char == quote_) quote_ = '\0';
+    return false;
+  }
+  if ((new_char == '"') or (new_char == '\'')) {
+    quote_ = new_char;
+    parameter_start_ = false;
+    return false;
+  }
+  //Message unit separator
+  if (new_char == ';') {
+    unit_start_ = message_length_;
+    unit_state_ = 0;
+    parameter_start_ = false;
+    return false;
+  }
+  //White spaces end the header
+  if (isspace(new_char)) {
+    if (unit_state_ == 1) {
+      unit_state_ = 2;
+      parameter_start_ = true;
+    }
+    return false;
+  }
+  if (unit_state_ == 0) unit_state_ = 1;
+  if ((new_char == ',') and (unit_state_ == 2)) {
+    parameter_start_ = true;
+    return false;
+  }
+  if ((new_char == '#') and parameter_start_) block_state_ = -1;
+  parameter_start_ = false;
+  return false;
 }
 
 /*!
- Change the TreeBase for the next RegisterCommand calls.
- @param tree_base  TreeBase to be used.  
-        An empty string ``""`` sets the TreeBase to root.
+ Execute the message units received before a block parameter.
+ @param session  Receive state of the interface.
+ @param interface  The source of the message.
+ @param term_chars  Termination chars of the message.
+
+ The previous message units are executed as usual, then the unit with the
+ block is executed (with their header path, e.g. ``SOUR:VOLT 1;DATA #14abcd``
+ executes ``SOUR:DATA``) using a SCPI_Block_Stream as its interface, so its
+ procedure reads the data directly from the interface, without using the
+ message buffer. The unread data is discarded afterwards.  
+ While the parser waits for the pending operations (after ``*WAI`` or 
+ ``*OPC?``) the block can not be queued, it is discarded and the error 
+ handler is called (BufferOverflow error).
 */
-void SCPI_Parser::SetCommandTreeBase(char* tree_base) {
-  SCPI_Commands tree_tokens(tree_base);
-  if (tree_tokens.Size() == 0) {
-    tree_code_ = 0;
-    tree_length_ = 0;
-    return;
+template <class Config>
+void SCPI_Basic_Parser<Config>::ExecuteBlock_(session_t& session,
+                                              Stream& interface,
+                                              const char* term_chars) {
+  bool indefinite = (session.msg_buffer_[session.message_length_ - 1] == '0')
+                    and (session.msg_buffer_[session.message_length_ - 2] 
+                         == '#');
+  session.msg_buffer_[session.message_length_] = '\0';
+  //Execute the previous message units, the block unit follows their path
+  header_path path;
+  if (session.unit_start_ > 0) {
+    session.msg_buffer_[session.unit_start_ - 1] = '\0';
+    this->Execute_(session.msg_buffer_, interface, path);
   }
-  for (uint8_t i = 0; i < tree_tokens.Size(); i++)
-    AddToken_(tree_tokens[i]);
-  tree_code_ = 0;
-  tree_code_ = this->GetCommandCode_(tree_tokens);
-  tree_length_ = tree_tokens.Size();
-  if (tree_tokens.overflow_error) {
-    setup_errors.branch_overflow = true;
-    tree_code_ = invalid_hash;
-  } 
+  SCPI_Block_Stream block(session, interface, session.block_length_, 
+                          indefinite, term_chars, timeout);
+  #if SCPI_MAX_OPERATIONS
+  //The block data can not be queued (after *WAI or *OPC?), it is discarded
+  if (waiting_) {
+    this->SetError_(ErrorCode::BufferOverflow);
+    this->CallErrorHandler_(interface);
+  } else
+  #endif
+  {
+    this->Execute_(&session.msg_buffer_[session.unit_start_], block, path);
+    #if SCPI_MAX_STREAMS
+    this->RetargetResponses_(block, interface);
+    #endif
+  }
+  if (not block.Discard()) {
+    //Call ErrorHandler due Timeout
+    this->SetError_(ErrorCode::Timeout);
+    this->CallErrorHandler_(interface);
+  }
+  //The termination chars of indefinite length blocks are allready read
+  session.after_block_ = not indefinite;
+}
+
+///SCPI_Block_Stream constructor.
+SCPI_Block_Stream::SCPI_Block_Stream(SCPI_Session_State& session, Stream& interface,
+                                     uint32_t length, bool indefinite,
+                                     const char* term_chars, 
+                                     unsigned long timeout)
+  : session_(session), interface_(interface), timeout_(timeout), 
+    remaining_(length), indefinite_(indefinite), term_chars_(term_chars) {
+  this->setTimeout(timeout);
 }
 
 /*!
- SetCommandTreeBase version with RAM string support.
+ Get the next data char.
+ @return the char, or -1 if the block ended or no chars are available yet.
 
- Example:  
- ``my_instrument.SetCommandTreeBase("SYSTem:LED");``  
- For lower RAM usage use the Flash strings version.
+ For indefinite length blocks, received chars that match the start of the
+ termination chars are kept until the match fails (they are data) or
+ completes (end of the block).
 */
-void SCPI_Parser::SetCommandTreeBase(const char* tree_base) {
-  strcpy(msg_buffer_, tree_base);
-  this->SetCommandTreeBase(msg_buffer_);
+int SCPI_Block_Stream::Next_() {
+  if (not indefinite_) {
+    if (remaining_ == 0) return -1;
+    int c = session_.ReadInput_(interface_);
+    if (c >= 0) remaining_--;
+    return c;
+  }
+  while (true) {
+    if (emit_index_ < emit_count_) 
+      return (unsigned char)term_chars_[emit_index_++];
+    if (pending_ >= 0) {
+      int c = pending_;
+      pending_ = -1;
+      return c;
+    }
+    if (ended_) return -1;
+    int c = session_.ReadInput_(interface_);
+    if (c < 0) return -1;
+    if ( (term_chars_[0] != '\0') 
+         and (c == (unsigned char)term_chars_[matched_]) ) {
+      matched_++;
+      if (term_chars_[matched_] == '\0') ended_ = true;
+      continue;
+    }
+    //The matched chars were data
+    emit_index_ = 0;
+    emit_count_ = matched_;
+    matched_ = 0;
+    if ( (emit_count_ > 0) and (c == (unsigned char)term_chars_[0]) ) 
+      matched_ = 1;
+    else 
+      pending_ = c;
+  }
 }
 
-/*!
- SetCommandTreeBase version with Flash strings (F() macro) support.
+int SCPI_Block_Stream::available() {
+  int available = (peeked_ >= 0) + (emit_count_ - emit_index_) 
+                  + (pending_ >= 0);
+  if (indefinite_) {
+    if (not ended_) available += session_.AvailableInput_(interface_);
+    return available;
+  }
+  int input = session_.AvailableInput_(interface_);
+  return (uint32_t(input) < remaining_) ? available + input 
+                                        : available + remaining_;
+}
 
- Example:  
-  ``my_instrument.SetCommandTreeBase(F("SYSTem:LED"));``
-*/
-void SCPI_Parser::SetCommandTreeBase(const __FlashStringHelper* tree_base) {
-  strcpy_P(msg_buffer_, (const char *) tree_base);
-  this->SetCommandTreeBase(msg_buffer_);
+int SCPI_Block_Stream::read() {
+  if (peeked_ >= 0) {
+    int c = peeked_;
+    peeked_ = -1;
+    return c;
+  }
+  return this->Next_();
+}
+
+int SCPI_Block_Stream::peek() {
+  if (peeked_ < 0) peeked_ = this->Next_();
+  return peeked_;
 }
 
 /*!
- Registers a new valid command and associate a procedure to it.
- @param command  New valid command.
- @param caller  Procedure associated to the valid command.
+ Read chars into a buffer.
+ @param buffer  Destination of the chars.
+ @param length  Max number of chars to read.
+ @return the number of chars read.
+
+ Definite length blocks are copied in chunks, from the receive buffer and
+ then from the interface (using the interface timeout).
 */
-void SCPI_Parser::RegisterCommand(char* command, SCPI_caller_t caller) {
-  if (codes_size_ >= max_commands) {
-    setup_errors.command_overflow = true;
-    return;
+size_t SCPI_Block_Stream::readBytes(char* buffer, size_t length) {
+  if (indefinite_ or (peeked_ >= 0)) return Stream::readBytes(buffer, length);
+  if (length > remaining_) length = remaining_;
+  size_t count = 0;
+  #if SCPI_RECEIVE_BUFFER_LENGTH
+  while ((count < length) and (session_.receive_size_ > 0)) {
+    size_t chunk = session_.receive_buffer_length - session_.receive_start_;
+    if (chunk > session_.receive_size_) chunk = session_.receive_size_;
+    if (chunk > length - count) chunk = length - count;
+    memcpy(buffer + count, &session_.receive_buffer_[session_.receive_start_], 
+           chunk);
+    session_.receive_start_ += chunk;
+    if (session_.receive_start_ == session_.receive_buffer_length) 
+      session_.receive_start_ = 0;
+    session_.receive_size_ -= chunk;
+    count += chunk;
   }
-  SCPI_Commands command_tokens(command);
-  for (uint8_t i = 0; i < command_tokens.Size(); i++)
-    this->AddToken_(command_tokens[i]);
-  scpi_hash_t code = this->GetCommandCode_(command_tokens);
-  
-  //Check for errors
-  if (code == unknown_hash) code = invalid_hash;
-  bool overflow_error = command_tokens.overflow_error;
-  overflow_error |= (tree_length_+command_tokens.Size()) 
-                    > command_tokens.storage_size;
-  setup_errors.command_overflow |= overflow_error;
-  if (overflow_error) code = invalid_hash;
+  #endif
+  if (count < length) 
+    count += interface_.readBytes(buffer + count, length - count);
+  remaining_ -= count;
+  return count;
+}
 
-  valid_codes_[codes_size_] = code;
-  callers_[codes_size_] = caller;
-  codes_size_++;
+size_t SCPI_Block_Stream::write(uint8_t c) { return interface_.write(c); }
+
+size_t SCPI_Block_Stream::write(const uint8_t* buffer, size_t size) {
+  return interface_.write(buffer, size);
 }
 
-/*!
- RegisterCommand version with RAM string support.
+int SCPI_Block_Stream::availableForWrite() { 
+  return interface_.availableForWrite();
+}
 
- Example:  
-  ``my_instrument.RegisterCommand("*IDN?", &Identify);``  
- For lower RAM usage use the Flash strings version.
-*/
-void SCPI_Parser::RegisterCommand(const char* command, SCPI_caller_t caller) {
-  strcpy(msg_buffer_, command);
-  this->RegisterCommand(msg_buffer_, caller);
+void SCPI_Block_Stream::flush() { interface_.flush(); }
+
+///All the data of the block has been read.
+bool SCPI_Block_Stream::Finished() {
+  if ((peeked_ >= 0) or (emit_index_ < emit_count_) or (pending_ >= 0)) 
+    return false;
+  return indefinite_ ? ended_ : (remaining_ == 0);
 }
 
 /*!
- RegisterCommand version with Flash strings (F() macro) support.
-
- Example:  
-  ``my_instrument.RegisterCommand(F("*IDN?"), &Identify);``
+ Discard the unread data of the block.
+ @return false if the data stops arriving (parser timeout) before the end
+ of the block.
 */
-void SCPI_Parser::RegisterCommand(const __FlashStringHelper* command, 
-                                  SCPI_caller_t caller) {
-  strcpy_P(msg_buffer_, (const char *) command);
-  this->RegisterCommand(msg_buffer_, caller);
+bool SCPI_Block_Stream::Discard() {
+  peeked_ = -1;
+  unsigned long last_read = millis();
+  while (not this->Finished()) {
+    if (this->Next_() >= 0) last_read = millis();
+    else if ((millis() - last_read) > timeout_) return false;
+  }
+  return true;
 }
+#endif
 
+#if SCPI_RESPONSE_BUFFER_LENGTH
 /*!
- Set the function to be used by the error handler.
-
- Example:  
-  ``my_instrument.SetErrorHandler(&myErrorHandler);``
+ SCPI_Response constructor.
+ @param interface  Interface where the responses are sent.
+ @param buffer  Buffer for the responses.
+ @param length  Length of the buffer.
 */
-void SCPI_Parser::SetErrorHandler(SCPI_caller_t caller){
-  callers_[max_commands] = caller;
+SCPI_Response::SCPI_Response(Stream& interface, char* buffer, size_t length)
+  : interface_(interface), buffer_(buffer), length_(length) {
+  this->setTimeout(interface.getTimeout());
+}
+
+int SCPI_Response::available() { return interface_.available(); }
+
+int SCPI_Response::read() { return interface_.read(); }
+
+int SCPI_Response::peek() { return interface_.peek(); }
+
+size_t SCPI_Response::write(uint8_t c) {
+  if (size_ == length_) this->Send_();
+  buffer_[size_++] = c;
+  return 1;
+}
+
+size_t SCPI_Response::write(const uint8_t* buffer, size_t size) {
+  size_t written = size;
+  while (size > 0) {
+    if (size_ == length_) this->Send_();
+    size_t chunk = length_ - size_;
+    if (chunk > size) chunk = size;
+    memcpy(buffer_ + size_, buffer, chunk);
+    size_ += chunk;
+    buffer += chunk;
+    size -= chunk;
+  }
+  return written;
+}
+
+///Free space in the response buffer.
+int SCPI_Response::availableForWrite() { return length_ - size_; }
+
+///Send the buffered data and flush the interface.
+void SCPI_Response::flush() {
+  this->Send_();
+  interface_.flush();
+}
+
+///Add an integer data element.
+void SCPI_Response::Add(long value) {
+  this->Separator_();
+  this->print(value);
+}
+
+///Add a real data element, with the given number of decimals.
+void SCPI_Response::Add(double value, uint8_t decimals) {
+  this->Separator_();
+  this->print(value, decimals);
+}
+
+///Add a data element (character data), written as is.
+void SCPI_Response::Add(const char* text) {
+  this->Separator_();
+  this->print(text);
 }
 
+///Add a data element (character data) stored in flash.
+void SCPI_Response::Add(const __FlashStringHelper* text) {
+  this->Separator_();
+  this->print(text);
+}
+
+///Add a string data element, between double quotes (inner ones doubled).
+void SCPI_Response::AddString(const char* text) {
+  this->Separator_();
+  this->write('"');
+  for (; text[0] != '\0'; text++) {
+    if (text[0] == '"') this->write('"');
+    this->write(text[0]);
+  }
+  this->write('"');
+}
+
+///Write ',' between data elements, and ';' between message units.
+void SCPI_Response::Separator_() {
+  if (elements_ > 0) this->write(',');
+  else if (has_units_) this->write(';');
+  if (elements_ < 255) elements_++;
+}
+
+///Start the response of the next message unit.
+void SCPI_Response::NextUnit_() {
+  if (elements_ > 0) has_units_ = true;
+  elements_ = 0;
+}
 
 /*!
- Process a message and execute it if a valid command is found.
- @param message  Message to be processed.
- @param interface  The source of the message.
- 
- Commands and parameters are extracted from the message,  
- if a valid command is found, its associated procedure is executed.  
- The command' tokens and parameters, and the interface is passed
- to the executed procedure.  
- @see GetMessage
+ Terminate the response message (if data elements were added) and send the
+ buffered data.
 */
-void SCPI_Parser::Execute(char* message, Stream &interface) {
-  while (message != NULL) {
-    //Save multicomands for later
-    char* multicomands = strpbrk(message, ";");
-    if (multicomands != NULL) {
-     multicomands[0] = '\0';
-     multicomands++;
-    }
+void SCPI_Response::End_() {
+  if ((elements_ > 0) or has_units_) this->write('\n');
+  elements_ = 0;
+  has_units_ = false;
+  this->Send_();
+}
 
-    tree_code_ = 0;
-    SCPI_Commands commands(message);
-    message = multicomands;
-    SCPI_Parameters parameters(commands.not_processed_message);
-    scpi_hash_t code = this->GetCommandCode_(commands);
-    if (code == unknown_hash) {
-      //Call ErrorHandler UnknownCommand
-      last_error = ErrorCode::UnknownCommand;
-      (*callers_[max_commands])(commands, parameters, interface);
-      continue;
-    }
-    for (uint8_t i = 0; i < codes_size_; i++)
-      if (valid_codes_[i] == code) {
-        (*callers_[i])(commands, parameters, interface);
-        break;
-      }  
-  }
+///Send the buffered data to the interface.
+void SCPI_Response::Send_() {
+  if (size_ == 0) return;
+  interface_.write((const uint8_t*)buffer_, size_);
+  size_ = 0;
 }
+#endif
 
+#if SCPI_RECEIVE_BUFFER_LENGTH
 /*!
- Gets a message from a Stream interface and execute it.
- @see GetMessage
- @see Execute
+ Read the available chars of an interface into the receive buffer.
+ @return true if new chars were stored.
+
+ The chars are read in chunks using ``readBytes``, never requesting more
+ than ``available()`` chars, so it does not wait for the interface timeout.
 */
-void SCPI_Parser::ProcessInput(Stream& interface, const char* term_chars) {
-  char* message = this->GetMessage(interface, term_chars);
-  if (message != NULL) {
-    this->Execute(message, interface);
+bool SCPI_Session_State::ReceiveInput_(Stream& interface) {
+  bool received = false;
+  int available = interface.available();
+  while ((available > 0) and (receive_size_ < receive_buffer_length)) {
+    //Free contiguous space after the stored chars
+    uint16_t end = receive_start_ + receive_size_;
+    if (end >= receive_buffer_length) end -= receive_buffer_length;
+    uint16_t space = (end < receive_start_) ? receive_start_ - end 
+                                            : receive_buffer_length - end;
+    if (int(space) > available) space = available;
+    size_t count = interface.readBytes(&receive_buffer_[end], space);
+    if (count == 0) break;
+    receive_size_ += count;
+    available -= count;
+    received = true;
   }
+  return received;
+}
+
+///SCPI_Input_Stream constructor.
+SCPI_Input_Stream::SCPI_Input_Stream(SCPI_Session_State& session, 
+                                     Stream& interface)
+  : session_(session), interface_(interface) {}
+
+int SCPI_Input_Stream::available() {
+  return session_.AvailableInput_(interface_);
+}
+
+int SCPI_Input_Stream::read() { return session_.ReadInput_(interface_); }
+
+int SCPI_Input_Stream::peek() { return session_.PeekInput_(interface_); }
+
+size_t SCPI_Input_Stream::write(uint8_t c) { return interface_.write(c); }
+
+size_t SCPI_Input_Stream::write(const uint8_t* buffer, size_t size) {
+  return interface_.write(buffer, size);
+}
+
+int SCPI_Input_Stream::availableForWrite() { 
+  return interface_.availableForWrite();
 }
 
+void SCPI_Input_Stream::flush() { interface_.flush(); }
+#endif
+
 /*!
  Gets a message from a Stream interface.
  @param interface  A Stream interface like Serial or Ethernet.
@@ -286,63 +3013,144 @@ void SCPI_Parser::ProcessInput(Stream& interface, const char* term_chars) {
   A timeout occurs (SCPI_Parser::timeout ms without new chars) (default 10 ms)  
   The message buffer overflows
 */
-char* SCPI_Parser::GetMessage(Stream& interface, const char* term_chars) {
+template <class Config>
+char* SCPI_Basic_Parser<Config>::GetMessage(Stream& interface,
+                                            const char* term_chars) {
+  return this->GetMessage(session_, interface, term_chars);
+}
+
+/*!
+ GetMessage version for a SCPI_Session.
+ @param session  Receive state of the interface, use one for each interface.
+ @param interface  A Stream interface like Serial or Ethernet.
+ @param term_chars  Termination chars e.g. ``"\r\n"``.
+ @return the read message if the ``term_chars`` are found, otherwise ``NULL``.
+
+ The partial messages of each interface are kept in its own session, so
+ several interfaces can be read in the same loop.  
+ The returned message is stored in the session's buffer.
+*/
+template <class Config>
+char* SCPI_Basic_Parser<Config>::GetMessage(session_t& session,
+                                            Stream& interface,
+                                            const char* term_chars) {
+  size_t term_length = strlen(term_chars);
+  bool received = false;
+  #if SCPI_RECEIVE_BUFFER_LENGTH
+  while ((session.receive_size_ > 0) or session.ReceiveInput_(interface)) {
+    //Read the new char from the receive buffer
+    char new_char = session.receive_buffer_[session.receive_start_];
+    if (++session.receive_start_ == session.receive_buffer_length) 
+      session.receive_start_ = 0;
+    session.receive_size_--;
+  #else
   while (interface.available()) {
     //Read the new char
-    msg_buffer_[message_length_] = interface.read();
-    ++message_length_;
-    time_checker_ = millis();
+    char new_char = interface.read();
+  #endif
+    session.msg_buffer_[session.message_length_] = new_char;
+    ++session.message_length_;
+    received = true;
 
-    if (message_length_ >= buffer_length){
+    if (session.message_length_ >= buffer_length){
       //Call ErrorHandler due BufferOverflow
-      last_error = ErrorCode::BufferOverflow;
-      (*callers_[max_commands])(SCPI_C(), SCPI_P(), interface);
-      message_length_ = 0;
+      this->SetError_(ErrorCode::BufferOverflow);
+      #if SCPI_STATISTICS
+      statistics.max_message_length = buffer_length;
+      #endif
+      this->CallErrorHandler_(interface);
+      session.message_length_ = 0;
       return NULL;
     }
     
     #if SCPI_MAX_SPECIAL_COMMANDS
+    if (session.message_length_ == 1) session.message_has_space_ = false;
     //For the first space only.
-    if (strcspn(msg_buffer_, " ") == message_length_- 1){
-      msg_buffer_[message_length_ - 1] =  '\0';
-      tree_code_ = 0;
-      SCPI_Commands commands(msg_buffer_);
-      scpi_hash_t code = this->GetCommandCode_(commands);
-      for (uint8_t i = 0; i < special_codes_size_; i++) 
+    if ((new_char == ' ') and not session.message_has_space_) {
+      session.message_has_space_ = true;
+      session.msg_buffer_[session.message_length_ - 1] =  '\0';
+      SCPI_Commands commands;
+      //Only headers without white spaces or previous message units (';')
+      bool header_only = (commands.Tokenize_(session.msg_buffer_)[0] == '\0');
+      hash_t code = header_only ? this->GetCommandCode_(commands, 0) 
+                                     : unknown_hash;
+      for (uint8_t i = 0; header_only and (i < special_codes_size_); i++) 
         if (valid_special_codes_[i] == code) {
+          #if SCPI_RECEIVE_BUFFER_LENGTH
+          //Chars in the receive buffer are read first
+          SCPI_Input_Stream input(session, interface);
+          (*special_callers_[i])(commands, input);
+          #if SCPI_MAX_STREAMS
+          this->RetargetResponses_(input, interface);
+          #endif
+          #else
           (*special_callers_[i])(commands, interface);
-          message_length_ = 0;
-          return msg_buffer_;
+          #endif
+          session.message_length_ = 0;
+          return session.msg_buffer_;
         }
       //restore original message.
-      msg_buffer_[message_length_ - 1] = ' ';
+      session.msg_buffer_[session.message_length_ - 1] = ' ';
       for (uint8_t i = 0; i < commands.Size()-1; i++)
         commands[i][strlen(commands[i])] = ':';
-      commands.not_processed_message--;
-      commands.not_processed_message[0] = ' ';
+    }
+    #endif
+
+    #if SCPI_BLOCK_DATA
+    //Skip the white spaces and the message unit separator after a block
+    if ( (session.message_length_ == 1) and session.after_block_ 
+         and ((new_char == ';') or isspace(new_char)) ) {
+      session.message_length_ = 0;
+      session.after_block_ = (new_char != ';');
+      continue;
+    }
+    if (session.ScanBlockHeader_(new_char)) {
+      this->ExecuteBlock_(session, interface, term_chars);
+      session.message_length_ = 0;
+      continue;
     }
     #endif
 
     //Test for termination chars (end of the message)
-    msg_buffer_[message_length_] = '\0';
-    if (strstr(msg_buffer_, term_chars) != NULL) {
+    //Only the last received chars are compared, the termination chars can
+    //not be found earlier as every received char is tested.
+    if ( (session.message_length_ >= term_length)
+         and (memcmp(session.msg_buffer_ + session.message_length_ 
+                     - term_length, term_chars, term_length) == 0) ) {
       //Return the received message
-      msg_buffer_[message_length_ - strlen(term_chars)] =  '\0';
-      message_length_ = 0;
-      return msg_buffer_;
+      session.msg_buffer_[session.message_length_ - term_length] =  '\0';
+      #if SCPI_STATISTICS
+      if (session.message_length_ - term_length 
+          > statistics.max_message_length)
+        statistics.max_message_length = session.message_length_ - term_length;
+      #endif
+      #if SCPI_BLOCK_DATA
+      //Nothing left after a block
+      bool empty = session.after_block_ 
+                   and (session.message_length_ == term_length);
+      session.after_block_ = false;
+      if (empty) {
+        session.message_length_ = 0;
+        continue;
+      }
+      #endif
+      session.message_length_ = 0;
+      return session.msg_buffer_;
     }
   }
   //No more chars aviable yet
+  //The timeout is counted from the last received chars
+  if (received) session.time_checker_ = millis();
 
   //Return NULL if no message is incomming
-  if (message_length_ == 0) return NULL;
+  if (session.message_length_ == 0) return NULL;
 
   //Check for communication timeout
-  if ((millis() - time_checker_) > timeout) {
+  if ((millis() - session.time_checker_) > timeout) {
       //Call ErrorHandler due Timeout
-      last_error = ErrorCode::Timeout;
-      (*callers_[max_commands])(SCPI_C(), SCPI_P(), interface);
-      message_length_ = 0;
+      this->SetError_(ErrorCode::Timeout);
+      this->CallErrorHandler_(interface);
+      session.message_length_ = 0;
       return NULL;
   }
 
@@ -351,17 +3159,18 @@ char* SCPI_Parser::GetMessage(Stream& interface, const char* term_chars) {
 }
 
 ///Prints debug information to an interface.
-void SCPI_Parser::PrintDebugInfo(Stream& interface) 
+template <class Config>
+void SCPI_Basic_Parser<Config>::PrintDebugInfo(Stream& interface) 
 {
   interface.println(F("*** DEBUG INFO ***\n"));
   interface.print(F("Max command tree branches: "));
-  interface.print(SCPI_ARRAY_SYZE);
-  interface.println(F(" (SCPI_ARRAY_SYZE)"));
+  interface.print(max_command_depth);
+  interface.println(F(" (SCPI_MAX_COMMAND_DEPTH)"));
   if (setup_errors.branch_overflow) 
     interface.println(F(" **ERROR** Max branch size exceeded."));
   interface.print(F("Max number of parameters: "));
-  interface.print(SCPI_ARRAY_SYZE);
-  interface.println(F(" (SCPI_ARRAY_SYZE)"));
+  interface.print(max_parameters);
+  interface.println(F(" (SCPI_MAX_PARAMETERS)"));
   interface.print(F("Message buffer size: "));
   interface.print(buffer_length);
   interface.println(F(" (SCPI_BUFFER_LENGTH)\n"));
@@ -373,11 +3182,32 @@ void SCPI_Parser::PrintDebugInfo(Stream& interface)
   interface.println(F(" (SCPI_MAX_TOKENS)"));
   if (setup_errors.token_overflow) 
     interface.println(F(" **ERROR** Max tokens exceeded."));
+  interface.print(F("Token storage: "));
+  interface.print(token_buffer_size_);
+  interface.print(F(" / "));
+  interface.print(token_buffer_length);
+  interface.println(F(" (SCPI_TOKEN_BUFFER_LENGTH)"));
+  if (setup_errors.token_buffer_overflow) 
+    interface.println(F(" **ERROR** Token storage exceeded."));
   for (uint8_t i = 0; i < tokens_size_; i++) {
     interface.print(F("  "));
     interface.print(i+1);
     interface.print(F(":\t"));
-    interface.println(String(tokens_[i]));
+    //Print the token using its original format
+    uint8_t short_length = tokens_short_length_[i];
+    if (short_length == 0) short_length = strlen(tokens_[i]);
+    for (uint8_t k = 0; tokens_[i][k] != '\0'; k++) 
+      interface.print(char( (k < short_length) ? tokens_[i][k] 
+                                               : tolower(tokens_[i][k]) ));
+    for (uint16_t j = 0; j < keywords_size_; j++)
+      if (keywords_[j].token == i) {
+        if (keywords_[j].numeric_suffix) interface.print('#');
+        break;
+      }
+    #if SCPI_OPTIONAL_NODES
+    if (this->IsOptionalToken_(i)) interface.print(F("\t(optional)"));
+    #endif
+    interface.println();
     interface.flush();
   }
   interface.println();
@@ -412,7 +3242,11 @@ void SCPI_Parser::PrintDebugInfo(Stream& interface)
           break;
         }
     interface.print(F("\t\t0x"));
-    interface.print(long(callers_[i]), HEX);
+    long handler = long(callers_[i]);
+    #if SCPI_HANDLER_CONTEXT
+    if (context_callers_[i] != NULL) handler = long(context_callers_[i]);
+    #endif
+    interface.print(handler, HEX);
     interface.println();
     interface.flush();
   }
@@ -423,6 +3257,34 @@ void SCPI_Parser::PrintDebugInfo(Stream& interface)
   if (hash_crash) 
     interface.println(F(" **ERROR** Hash crashes found. (!!)"));
 
+  #if SCPI_CONST_TABLE
+  if (table_tokens_ != NULL) {
+    interface.println();
+    interface.print(F("COMMAND TABLE : "));
+    interface.print(table_size_);
+    interface.println(F(" (SCPI_CONST_TABLE)"));
+    interface.print(F("  Tokens: "));
+    for (const char* c = table_tokens_; pgm_read_byte(c) != '\0'; c++)
+      interface.print(char(pgm_read_byte(c)));
+    interface.println();
+    interface.println(F("  #\tHash\t\tHandler"));
+    for (uint8_t i = 0; i < table_size_; i++) {
+      hash_t code;
+      SCPI_caller_t caller;
+      memcpy_P(&code, &table_codes_[i], sizeof(hash_t));
+      memcpy_P(&caller, &table_callers_[i], sizeof(caller));
+      interface.print(F("  "));
+      interface.print(i+1);
+      interface.print(F(":\t"));
+      interface.print(code, HEX);
+      interface.print(F("\t\t0x"));
+      interface.print(long(caller), HEX);
+      interface.println();
+      interface.flush();
+    }
+  }
+  #endif
+
   #if SCPI_MAX_SPECIAL_COMMANDS
   hash_crash = false;
   unknown_error = false;
@@ -469,11 +3331,201 @@ void SCPI_Parser::PrintDebugInfo(Stream& interface)
   
   interface.println(F("\nHASH Configuration:"));
   interface.print(F("  Hash size: "));
-  interface.print(sizeof(scpi_hash_t)*8);
+  interface.print(sizeof(hash_t)*8);
   interface.println(F("bits (SCPI_HASH_TYPE)"));
   interface.print(F("  Hash magic number: "));
   interface.println(hash_magic_number);
   interface.print(F("  Hash magic offset: "));
   interface.println(hash_magic_offset);
+  if (setup_errors.hash_crash) 
+    interface.println(F(" **ERROR** Hash crashes found. "
+                        "Change the magic numbers or the SCPI_HASH_TYPE."));
+  interface.println(F("\n*******************\n"));
+}
+
+#if SCPI_STATISTICS
+/*!
+ Call a procedure and update its statistics.
+ @param index  Index of the registered command (``max_commands`` for the 
+        ErrorHandler, greater for commands without statistics).
+ @param caller  Procedure to be called.
+ @param unit_start  Time when the parsing of the message unit started 
+        (``micros()``).
+
+ The parse time is added to the statistics of the parser and to the 
+ ones of the command, it is not included in the command execution time.
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::CallMeasured_(uint8_t index,
+                                              SCPI_caller_t caller,
+                                              SCPI_C& commands,
+                                              SCPI_P& parameters,
+                                              Stream& interface,
+                                              unsigned long unit_start) {
+  unsigned long start = micros();
+  uint32_t parse_time = start - unit_start;
+  statistics.units++;
+  statistics.parse_time += parse_time;
+  if (parse_time > statistics.max_parse_time) 
+    statistics.max_parse_time = parse_time;
+  if (parameters.Size() > statistics.max_parameters) 
+    statistics.max_parameters = parameters.Size();
+
+  this->Call_(index, caller, commands, parameters, interface);
+
+  if (index > max_commands) return;
+  uint32_t time = micros() - start;
+  command_statistics& command_stats = command_stats_[index];
+  command_stats.calls++;
+  command_stats.total_time += time;
+  if (time > command_stats.max_time) command_stats.max_time = time;
+  command_stats.parse_time += parse_time;
+  if (parse_time > command_stats.max_parse_time) 
+    command_stats.max_parse_time = parse_time;
+}
+
+/*!
+ Get the statistics of a registered command.
+ @param command  Command, e.g. ``"MEASure:VOLTage?"``.
+ @param command_stats[out]  Statistics of the command.
+ @return false if the command is not registered.
+*/
+template <class Config>
+bool SCPI_Basic_Parser<Config>::GetCommandStatistics(
+    const char* command, command_statistics& command_stats) {
+  char header[Config::buffer_length];
+  strncpy(header, command, sizeof(header) - 1);
+  header[sizeof(header) - 1] = '\0';
+  uint32_t optional = 0;
+  #if SCPI_OPTIONAL_NODES
+  this->StripOptionalNodes_(header, optional);
+  #endif
+  SCPI_Commands command_tokens(header);
+  uint8_t index = this->FindCommand_(this->GetCommandCode_(command_tokens, 0,
+                                                           NULL, optional));
+  #if SCPI_OPTIONAL_NODES
+  //A received form of the command, e.g. "MEAS:SCAL:VOLT?"
+  if (index == max_commands) {
+    hash_t branch_code;
+    SCPI_caller_t caller;
+    index = this->FindBranchCaller_(command_tokens, 0, branch_code, caller);
+  }
+  #endif
+  if (index >= max_commands) return false;
+  command_stats = command_stats_[index];
+  return true;
+}
+
+///Clear the runtime statistics.
+template <class Config>
+void SCPI_Basic_Parser<Config>::ResetStatistics() {
+  statistics = parser_statistics();
+  for (uint8_t i = 0; i <= max_commands; i++) 
+    command_stats_[i] = command_statistics();
+}
+
+/*!
+ Prints the runtime statistics to an interface, as a list of numbers.
+
+ Call it from the procedure of a statistics query, e.g. 
+ ``SYSTem:STATistics?``.  
+ The response is a list of comma separated numbers:  
+  units, parse_time, max_parse_time, max_message_length, max_parameters,  
+  the number of errors (UnknownCommand, Timeout, BufferOverflow, 
+  MissingParameter, InvalidParameter, OutOfRange, QueryInterrupted and 
+  OperationIgnored),  
+  and hash, calls, total_time, max_time, parse_time and max_parse_time for
+  each registered command (the last one, with hash 0, is the ErrorHandler).
+ Times are in microseconds. The first parse times are for all the message 
+ units, the times of the commands only include their procedures and their
+ parse times the parsing of their message units.
+*/
+template <class Config>
+void SCPI_Basic_Parser<Config>::PrintStatisticsList(Stream& interface) {
+  interface.print(statistics.units);
+  interface.print(',');
+  interface.print(statistics.parse_time);
+  interface.print(',');
+  interface.print(statistics.max_parse_time);
+  interface.print(',');
+  interface.print(statistics.max_message_length);
+  interface.print(',');
+  interface.print(statistics.max_parameters);
+  for (uint8_t i = 1; i <= uint8_t(ErrorCode::OperationIgnored); i++) {
+    interface.print(',');
+    interface.print(statistics.errors[i]);
+  }
+  for (uint8_t i = 0; i <= codes_size_; i++) {
+    //The last one is the ErrorHandler (unknown commands, hash 0)
+    uint8_t j = (i == codes_size_) ? max_commands : i;
+    interface.print(',');
+    interface.print((j == max_commands) ? 0 : valid_codes_[j]);
+    interface.print(',');
+    interface.print(command_stats_[j].calls);
+    interface.print(',');
+    interface.print(command_stats_[j].total_time);
+    interface.print(',');
+    interface.print(command_stats_[j].max_time);
+    interface.print(',');
+    interface.print(command_stats_[j].parse_time);
+    interface.print(',');
+    interface.print(command_stats_[j].max_parse_time);
+  }
+  interface.println();
+}
+
+///Prints the runtime statistics to an interface.
+template <class Config>
+void SCPI_Basic_Parser<Config>::PrintStatistics(Stream& interface) {
+  interface.println(F("*** STATISTICS ***\n"));
+  interface.print(F("Message units: "));
+  interface.println(statistics.units);
+  interface.print(F("Parse time of all units (us): "));
+  interface.print(statistics.parse_time);
+  interface.print(F(" total, "));
+  interface.print(statistics.max_parse_time);
+  interface.println(F(" max"));
+  interface.print(F("Longest message: "));
+  interface.print(statistics.max_message_length);
+  interface.print(F(" / "));
+  interface.print(buffer_length);
+  interface.println(F(" (SCPI_BUFFER_LENGTH)"));
+  interface.print(F("Max parameters: "));
+  interface.print(statistics.max_parameters);
+  interface.print(F(" / "));
+  interface.print(max_parameters);
+  interface.println(F(" (SCPI_MAX_PARAMETERS)"));
+  interface.print(F("Errors (Unknown, Timeout, Overflow, Missing, Invalid, "
+                    "Range, Interrupted, Ignored): "));
+  for (uint8_t i = 1; i <= uint8_t(ErrorCode::OperationIgnored); i++) {
+    if (i > 1) interface.print(F(", "));
+    interface.print(statistics.errors[i]);
+  }
+  interface.println();
+  interface.println(F("\n  #\tHash\tCalls\tTotal us\tMax us\t"
+                      "Parse us\tMax parse us"));
+  for (uint8_t i = 0; i <= codes_size_; i++) {
+    uint8_t j = (i == codes_size_) ? max_commands : i;
+    if (j == max_commands) {
+      interface.print(F("  Error handler\t"));
+    } else {
+      interface.print(F("  "));
+      interface.print(i+1);
+      interface.print(F(":\t"));
+      interface.print(valid_codes_[j], HEX);
+    }
+    interface.print('\t');
+    interface.print(command_stats_[j].calls);
+    interface.print('\t');
+    interface.print(command_stats_[j].total_time);
+    interface.print(F("\t\t"));
+    interface.print(command_stats_[j].max_time);
+    interface.print('\t');
+    interface.print(command_stats_[j].parse_time);
+    interface.print(F("\t\t"));
+    interface.println(command_stats_[j].max_parse_time);
+    interface.flush();
+  }
   interface.println(F("\n*******************\n"));
 }
+#endif
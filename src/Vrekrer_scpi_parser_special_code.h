@@ -9,8 +9,13 @@
  @param command  New valid command.
  @param caller  Procedure associated to the valid command.
 */
-void SCPI_Parser::RegisterSpecialCommand(char* command, 
-                                         SCPI_special_caller_t caller) {
+template <class Config>
+void SCPI_Basic_Parser<Config>::RegisterSpecialCommand(
+    char* command, SCPI_special_caller_t caller) {
+  if (frozen_) return;
+  #if SCPI_HEADER_CACHE
+  this->ClearHeaderCache_();
+  #endif
   if (special_codes_size_ >= max_special_commands) {
     setup_errors.special_command_overflow = true;
     return;
@@ -18,15 +23,25 @@ void SCPI_Parser::RegisterSpecialCommand(char* command,
   SCPI_Commands command_tokens(command);
   for (uint8_t i = 0; i < command_tokens.Size(); i++)
     this->AddToken_(command_tokens[i]);
-  scpi_hash_t code = this->GetCommandCode_(command_tokens);
+  hash_t code = this->GetCommandCode_(command_tokens);
   
   //Check for errors
   if (code == unknown_hash) code = invalid_hash;
   bool overflow_error = command_tokens.overflow_error;
   overflow_error |= (tree_length_+command_tokens.Size()) 
-                    > command_tokens.storage_size;
+                    > max_command_depth;
   setup_errors.branch_overflow |= overflow_error;
   if (overflow_error) code = invalid_hash;
+  if ((code != invalid_hash) and this->IsRegistered_(code)) 
+    setup_errors.hash_crash = true;
+  #if SCPI_HASH_SEARCH
+  command_record& record = special_records_[special_codes_size_];
+  this->RecordCommand_(command_tokens, record);
+  if (overflow_error) record.size = 0;
+  //A valid command with a reserved hash is also a hash crash
+  if ((record.size != 0) and (code == invalid_hash)) 
+    setup_errors.hash_crash = true;
+  #endif
 
   valid_special_codes_[special_codes_size_] = code;
   special_callers_[special_codes_size_] = caller;
@@ -40,10 +55,12 @@ void SCPI_Parser::RegisterSpecialCommand(char* command,
   ``my_instrument.RegisterSpecialCommand("GET:DATA", &getData);``  
  For lower RAM usage use the Flash strings version.
 */
-void SCPI_Parser::RegisterSpecialCommand(const char* command, 
-                                         SCPI_special_caller_t caller) {
-  strcpy(msg_buffer_, command);
-  this->RegisterSpecialCommand(msg_buffer_, caller);
+template <class Config>
+void SCPI_Basic_Parser<Config>::RegisterSpecialCommand(
+    const char* command, SCPI_special_caller_t caller) {
+  if (frozen_) return;
+  strcpy(session_.msg_buffer_, command);
+  this->RegisterSpecialCommand(session_.msg_buffer_, caller);
 }
 
 /*!
@@ -52,10 +69,12 @@ void SCPI_Parser::RegisterSpecialCommand(const char* command,
  Example:  
   ``my_instrument.RegisterSpecialCommand("GET:DATA", &getData);``
 */
-void SCPI_Parser::RegisterSpecialCommand(const __FlashStringHelper* command, 
-                                         SCPI_special_caller_t caller) {
-  strcpy_P(msg_buffer_, (const char *) command);
-  this->RegisterSpecialCommand(msg_buffer_, caller);
+template <class Config>
+void SCPI_Basic_Parser<Config>::RegisterSpecialCommand(
+    const __FlashStringHelper* command, SCPI_special_caller_t caller) {
+  if (frozen_) return;
+  strcpy_P(session_.msg_buffer_, (const char *) command);
+  this->RegisterSpecialCommand(session_.msg_buffer_, caller);
 }
 
 